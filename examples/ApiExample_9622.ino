@@ -69,6 +69,11 @@ void setup() {
 }
 
 void loop() {
+#ifdef _CONSOLE
+  pca9532_1.resetBusStats(); // count bus traffic per loop() iteration
+  pca9532_2.resetBusStats();
+#endif
+
   pca9532_1.setGrpPwm(13); // set global brightness to 5%
   /* pca9532_1.setLsState(LS_STATE_OFF, REG_LS0, BIT_LS_LED0); // (not connected)
   delay(500); // wait 500ms */
@@ -164,4 +169,12 @@ void loop() {
   delay(20); // wait 20ms
   pca9622.setGrpPwm(0); // set global brightness to 0%
   delay(500); // wait 500ms
+
+#ifdef _CONSOLE
+  Serial.print("loop: "); // report bus traffic of both PCA9532 for this iteration
+  Serial.print(pca9532_1.getBusBytes() + pca9532_2.getBusBytes());
+  Serial.print(" bus bytes, ");
+  Serial.print(pca9532_1.getBusTransactions() + pca9532_2.getBusTransactions());
+  Serial.println(" transactions");
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+/*
+   Copyright (C) 2021 Daniel Guedel
+
+   This file is subject to the terms and conditions of the GNU Lesser
+   General Public License v2.1. See the file LICENSE in the top level
+   directory for more details.
+*/
+
+/*
+   CPU cost of the pure-compute parts of the driver (LS packing, brightness
+   model, bus cost model, frame planning). No PCA9532 needs to be connected.
+
+   Every benchmark takes BENCH_SAMPLES samples of a batch of calls and prints
+   min / median / max per call, so interrupts and cache effects show up as
+   outliers instead of shifting the result. Compare the median between
+   builds to catch CPU regressions.
+
+   Units:
+     - Cortex-M3/M4/M7: CPU cycles from the DWT cycle counter
+     - Cortex-M0/M0+:   CPU cycles from SysTick
+     - other targets:   nanoseconds from micros()
+*/
+
+#define BAUDRATE 115200
+
+#include "Arduino.h"
+#include "PCA9532.h"
+#include "PCA9532Panel.h"
+#include "PCA9532Budget.h"
+#include "PCA9532Lookahead.h"
+
+#define BENCH_SAMPLES 31 // samples per benchmark (odd for a true median)
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  #define BENCH_UNIT "cycles"
+  #define DEMCR      (*(volatile uint32_t *) 0xE000EDFC) // debug exception and monitor control
+  #define DWT_CTRL   (*(volatile uint32_t *) 0xE0001000) // DWT control
+  #define DWT_CYCCNT (*(volatile uint32_t *) 0xE0001004) // DWT cycle counter
+#elif defined(__ARM_ARCH_6M__)
+  #define BENCH_UNIT "cycles"
+  #define SYST_RVR   (*(volatile uint32_t *) 0xE000E014) // SysTick reload value
+  #define SYST_CVR   (*(volatile uint32_t *) 0xE000E018) // SysTick current value (counts down)
+#else
+  #define BENCH_UNIT "ns"
+#endif
+
+volatile uint8_t sink; // results go here so the compiler cannot drop the work
+volatile uint8_t seed = 0x5A; // inputs come from here so they cannot be folded
+
+uint8_t image[REG_COUNT] = { 0x00, 0x00, 0x00, 0x40, 0x00, 0xC0, 0x1B, 0xE4, 0x55, 0xAA };
+uint8_t show[4][LOOKAHEAD_OUTPUTS];
+uint8_t planned[4][REG_COUNT];
+
+/**
+ * Start of a measurement
+ */
+uint32_t benchStart() {
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  return DWT_CYCCNT;
+#elif defined(__ARM_ARCH_6M__)
+  // milliseconds count SysTick reloads, the current value the cycles within;
+  // read again if SysTick wrapped between the two reads
+  uint32_t ms;
+  uint32_t cvr;
+  do {
+    ms = millis();
+    cvr = SYST_CVR;
+  } while (ms != millis());
+  return ms * (SYST_RVR + 1) + (SYST_RVR - cvr);
+#else
+  return micros();
+#endif
+}
+
+/**
+ * Time since benchStart() per call
+ *
+ * @param start Value of benchStart()
+ * @param calls Number of calls measured
+ *
+ * @return cycles or nanoseconds per call
+ */
+uint32_t benchStop(uint32_t start, uint16_t calls) {
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_6M__)
+  return (benchStart() - start) / calls;
+#else
+  return (benchStart() - start) * 1000UL / calls;
+#endif
+}
+
+/**
+ * Run one benchmark and print min / median / max per call
+ *
+ * @param name  Name to print
+ * @param body  Function doing a batch of calls
+ * @param calls Number of calls per batch
+ */
+void bench(const char *name, void (*body)(), uint16_t calls) {
+
+  uint32_t samples[BENCH_SAMPLES];
+
+  body(); // warm up
+
+  for (uint8_t s = 0; s < BENCH_SAMPLES; s++) {
+    uint32_t start = benchStart();
+    body();
+    uint32_t value = benchStop(start, calls);
+
+    // insertion sort, keeps the samples ordered for min / median / max
+    uint8_t i = s;
+    while (i > 0 && samples[i - 1] > value) {
+      samples[i] = samples[i - 1];
+      i--;
+    }
+    samples[i] = value;
+  }
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(samples[0]);
+  Serial.print(" / ");
+  Serial.print(samples[BENCH_SAMPLES / 2]);
+  Serial.print(" / ");
+  Serial.print(samples[BENCH_SAMPLES - 1]);
+  Serial.println(" " BENCH_UNIT " per call (min / median / max)");
+}
+
+void benchPackLsState() {
+
+  uint8_t reg = seed;
+  for (uint8_t i = 0; i < 64; i++) {
+    reg = PCA9532::packLsState(reg, i & 0b11, (i >> 1) & 0b110);
+  }
+  sink = reg;
+}
+
+void benchPackLsStateAll() {
+
+  uint8_t reg = seed;
+  for (uint8_t i = 0; i < 64; i++) {
+    reg ^= PCA9532::packLsStateAll(i);
+  }
+  sink = reg;
+}
+
+void benchOutputBrightness() {
+
+  uint8_t sum = seed;
+  for (uint8_t i = 0; i < 64; i++) {
+    sum += PCA9532Panel::outputBrightness(image, i & 0x0F);
+  }
+  sink = sum;
+}
+
+void benchBudgetBytes() {
+
+  uint8_t sum = seed;
+  for (uint16_t mask = 0; mask < 64; mask++) {
+    sum += PCA9532Budget::bytes((mask * 0x2D) & 0x3FC);
+  }
+  sink = sum;
+}
+
+void benchPlanFrame() {
+
+  sink = PCA9532Lookahead::plan(show, 4, 1, 8, planned);
+}
+
+void benchPlanLookahead() {
+
+  sink = PCA9532Lookahead::plan(show, 4, 2, 8, planned);
+}
+
+void setup() {
+  Serial.begin(BAUDRATE); // open serial communications with defined baudrate
+  while (!Serial) {
+   ; // wait until port is open (only necessary for native USB port)
+  }
+  delay(500);
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  DEMCR |= 1UL << 24; // enable trace (TRCENA)
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 1; // enable the cycle counter (CYCCNTENA)
+#endif
+
+  // a slow fade of two groups with a little jitter
+  for (uint8_t f = 0; f < 4; f++) {
+    for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+      show[f][o] = (o < 8 ? 60 + 5 * f : 180 - 4 * f) + (f * 7 + o * 13) % 9;
+    }
+  }
+
+  Serial.println("\nPCA9532 CPU benchmarks");
+  bench("packLsState", benchPackLsState, 64);
+  bench("packLsStateAll", benchPackLsStateAll, 64);
+  bench("Panel::outputBrightness", benchOutputBrightness, 64);
+  bench("Budget::bytes", benchBudgetBytes, 64);
+  bench("Lookahead::plan (4 frames, window 1)", benchPlanFrame, 1);
+  bench("Lookahead::plan (4 frames, window 2)", benchPlanLookahead, 1);
+}
+
+void loop() {
+}
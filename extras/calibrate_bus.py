@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 Daniel Guedel
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+#
+# Fit the bus cost model (PCA9532BusProfile) from logic analyser captures.
+#
+# Input is the CSV export of an I2C protocol analyser with one row per
+# event, as written by Saleae Logic 2:
+#
+#   name,type,start_time,duration,ack,address,read,data
+#
+# where type is one of start, address, data, stop and times are seconds.
+# Transactions to other devices can be filtered with --address. The idle
+# time is fitted from the gaps between back-to-back transactions on the bus.
+#
+# Usage: calibrate_bus.py [--address 0x62] capture.csv [capture.csv ...]
+
+import argparse
+import csv
+import statistics
+import sys
+
+
+def transactions(rows, address):
+    """Yield the events of each START..STOP transaction on the bus and
+    whether it addressed the device."""
+    events = []
+    for row in rows:
+        kind = row['type'].strip().lower()
+        if kind == 'start' and not events:
+            events = [row]
+        elif events:
+            events.append(row)
+            if kind == 'stop':
+                addresses = [int(e['address'], 16) for e in events
+                             if e['type'].strip().lower() == 'address']
+                yield events, address is None or address in addresses
+                events = []
+
+
+def fit(paths, address, max_idle):
+    starts, pitches, stops, totals, idles = [], [], [], [], []
+
+    for path in paths:
+        with open(path, newline='') as f:
+            end = None
+            for events, matched in transactions(csv.DictReader(f), address):
+                # idle: from the end of a STOP to the next START on the bus,
+                # longer gaps are pauses of the application
+                begin = float(events[0]['start_time'])
+                if end is not None and begin - end <= max_idle:
+                    idles.append(begin - end)
+                end = float(events[-1]['start_time']) + float(events[-1]['duration'])
+
+                if not matched:
+                    continue
+
+                t = [float(e['start_time']) for e in events]
+                d = [float(e['duration']) for e in events]
+                kinds = [e['type'].strip().lower() for e in events]
+                byte_idx = [i for i, k in enumerate(kinds) if k in ('address', 'data')]
+                if not byte_idx:
+                    continue
+
+                # START: from START condition to the first byte
+                starts.append(t[byte_idx[0]] - t[0])
+                # byte pitch: start to start of consecutive bytes, this
+                # includes ACK, inter-byte gaps and clock stretching
+                for a, b in zip(byte_idx, byte_idx[1:]):
+                    if b == a + 1:
+                        pitches.append(t[b] - t[a])
+                totals.append((t[-1] + d[-1] - t[0], len(byte_idx)))
+
+    if not totals or not pitches:
+        sys.exit('no complete transactions found')
+
+    start = statistics.median(starts)
+    byte = statistics.median(pitches)
+    # STOP: whatever remains of the transaction after START and bytes
+    stop = statistics.median(max(0.0, total - start - n * byte) for total, n in totals)
+    # no back-to-back transactions: keep the bus free time of the clock
+    idle = statistics.median(idles) if idles else None
+
+    return start, byte, stop, idle, len(totals), len(idles)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Fit PCA9532BusProfile from I2C logic analyser CSV exports')
+    parser.add_argument('--address', type=lambda s: int(s, 0),
+                        help='7 bit device address to filter on')
+    parser.add_argument('--name', default='busProfile',
+                        help='name of the generated variable')
+    parser.add_argument('--max-idle', type=float, default=100e-6,
+                        help='longest STOP to START gap in seconds still '
+                             'counted as Wire overhead (default 100us)')
+    parser.add_argument('captures', nargs='+')
+    args = parser.parse_args()
+
+    start, byte, stop, idle, count, gaps = fit(args.captures, args.address,
+                                               args.max_idle)
+
+    ns = lambda s: int(round(s * 1e9))
+    if idle is None:
+        print('// fitted from %d transactions, no back-to-back transactions,'
+              ' set idleNanos to the bus free time (BUS_FREE_NANOS_*)' % count)
+        idle = 0.0
+    else:
+        print('// fitted from %d transactions and %d gaps' % (count, gaps))
+    print('const PCA9532BusProfile %s = { %d, %d, %d, %d };'
+          % (args.name, ns(start), ns(byte), ns(stop), ns(idle)))
+
+
+if __name__ == '__main__':
+    main()
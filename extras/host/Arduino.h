@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Host stub of the Arduino core for the tests in extras/host. Time is
+ * virtual: micros() and millis() read the clock of the simulated bus, which
+ * advances with bus traffic, delay() and delayMicroseconds() only
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define pgm_read_word(address) (*(const uint16_t *) (address))
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/**
+ * Serial console, prints to stdout if enabled (see HostBus::setVerbose())
+ */
+class HostSerial {
+public:
+    void begin(uint32_t baudrate);
+    operator bool() const { return true; }
+    void print(const char *text);
+    void print(unsigned long value);
+    void println(const char *text = "");
+    void println(unsigned long value);
+};
+
+extern HostSerial Serial;
+
+#endif //ARDUINO_H
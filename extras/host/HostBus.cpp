@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <atomic>
+#include "HostBus.h"
+#include "PCA9532Panel.h"
+
+// Bus time, read by micros() from any thread
+static std::atomic<uint64_t> clockNanos(0);
+
+static HostTiming timing;
+static HostFaults injected;
+static uint32_t random32;
+
+static uint8_t registers[HOST_ADDRESSES][REG_COUNT];
+static uint8_t pointer[HOST_ADDRESSES];
+static uint16_t pinLevels[HOST_ADDRESSES];
+static int32_t oscillatorPpm[HOST_ADDRESSES];
+static uint64_t oscillatorOrigin[HOST_ADDRESSES];
+
+static uint32_t busBytes;
+static uint32_t busTransactions;
+static uint32_t busFaults;
+
+static std::vector<HostWrite> writes;
+static FILE *captureFile;
+static bool verbose;
+
+// power-on register values (page 6, table 3)
+static void powerOn(uint8_t address) {
+
+  memset(registers[address], 0, REG_COUNT);
+  registers[address][REG_PWM0] = 0x80;
+  registers[address][REG_PWM1] = 0x80;
+  pointer[address] = 0;
+}
+
+// xorshift32, uniform in [0, 1)
+static bool chance(double probability) {
+
+  if (probability <= 0) {
+    return false;
+  }
+
+  random32 ^= random32 << 13;
+  random32 ^= random32 >> 17;
+  random32 ^= random32 << 5;
+
+  return random32 / 4294967296.0 < probability;
+}
+
+// INPUT0/INPUT1 from the pins: an output that is on pulls its pin LOW
+static void updateInputs(uint8_t address) {
+
+  uint8_t *regs = registers[address];
+  uint32_t time = HostBus::deviceMicros(address, clockNanos.load());
+  uint16_t pins = pinLevels[address];
+
+  for (uint8_t output = 0; output < 16; output++) {
+    if (PCA9532Panel::outputLevel(regs, output, time)) {
+      pins &= ~(1 << output);
+    }
+  }
+
+  regs[REG_INPUT0] = pins & 0xFF;
+  regs[REG_INPUT1] = pins >> 8;
+}
+
+static void capture(const char *type, uint64_t start, uint32_t duration,
+                    uint8_t address, bool isRead, int data, bool ack) {
+
+  if (!captureFile) {
+    return;
+  }
+
+  fprintf(captureFile, "I2C,%s,%.9f,%.9f,%s,0x%02X,%s,",
+          type, start * 1e-9, duration * 1e-9, ack ? "true" : "false",
+          address, isRead ? "true" : "false");
+  if (data >= 0) {
+    fprintf(captureFile, "0x%02X", data);
+  }
+  fprintf(captureFile, "\n");
+}
+
+static void start(uint8_t address, bool isRead) {
+
+  uint64_t now = clockNanos.load();
+
+  capture("start", now, timing.startNanos, address, isRead, -1, true);
+  clockNanos += timing.startNanos;
+}
+
+static void transfer(uint8_t address, bool isRead, const char *type, uint8_t data, bool ack) {
+
+  capture(type, clockNanos.load(), timing.byteNanos, address, isRead, data, ack);
+  clockNanos += timing.byteNanos;
+  busBytes++;
+}
+
+static void stop(uint8_t address, bool sendStop) {
+
+  if (!sendStop) {
+    return;
+  }
+
+  capture("stop", clockNanos.load(), timing.stopNanos, address, false, -1, true);
+  clockNanos += timing.stopNanos + timing.idleNanos;
+  busTransactions++;
+}
+
+/******************************* ARDUINO CORE *********************************/
+
+
+HostSerial Serial;
+TwoWire Wire;
+
+uint32_t micros() {
+
+  return clockNanos.load() / 1000;
+}
+
+uint32_t millis() {
+
+  return clockNanos.load() / 1000000;
+}
+
+void delay(uint32_t ms) {
+
+  clockNanos += (uint64_t) ms * 1000000;
+}
+
+void delayMicroseconds(uint32_t us) {
+
+  clockNanos += (uint64_t) us * 1000;
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+void HostSerial::begin(uint32_t) {
+}
+
+void HostSerial::print(const char *text) {
+
+  if (verbose) {
+    fputs(text, stdout);
+  }
+}
+
+void HostSerial::print(unsigned long value) {
+
+  if (verbose) {
+    printf("%lu", value);
+  }
+}
+
+void HostSerial::println(const char *text) {
+
+  if (verbose) {
+    puts(text);
+  }
+}
+
+void HostSerial::println(unsigned long value) {
+
+  if (verbose) {
+    printf("%lu\n", value);
+  }
+}
+
+TwoWire::TwoWire() {
+
+  _address = 0;
+  _txLength = 0;
+  _rxLength = 0;
+  _rxIndex = 0;
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(uint32_t clockHz) {
+
+  HostBus::setTiming(HostBus::timingForClock(clockHz));
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+
+  _address = address;
+  _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+
+  if (_txLength >= WIRE_BUFFER_LENGTH) {
+    return 0;
+  }
+
+  _tx[_txLength++] = data;
+
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+
+  return HostBus::write(_address, _tx, _txLength, sendStop);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+
+  if (quantity > WIRE_BUFFER_LENGTH) {
+    quantity = WIRE_BUFFER_LENGTH;
+  }
+
+  _rxLength = HostBus::read(address, _rx, quantity, sendStop);
+  _rxIndex = 0;
+
+  return _rxLength;
+}
+
+int TwoWire::available() {
+
+  return _rxLength - _rxIndex;
+}
+
+int TwoWire::read() {
+
+  return _rxIndex < _rxLength ? _rx[_rxIndex++] : -1;
+}
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+void HostBus::reset() {
+
+  clockNanos.store(0);
+  timing = timingForClock(100000);
+  memset(&injected, 0, sizeof(injected));
+  random32 = 1;
+
+  for (uint16_t address = 0; address < HOST_ADDRESSES; address++) {
+    powerOn(address);
+    pinLevels[address] = 0xFFFF;
+    oscillatorPpm[address] = 0;
+    oscillatorOrigin[address] = 0;
+  }
+
+  resetStats();
+  writes.clear();
+  captureFile = NULL;
+}
+
+void HostBus::setTiming(const HostTiming &newTiming) {
+
+  timing = newTiming;
+}
+
+HostTiming HostBus::timingForClock(uint32_t clockHz) {
+
+  uint32_t bitNanos = 1000000000UL / clockHz;
+  uint32_t idleNanos = clockHz <= 100000 ? BUS_FREE_NANOS_SM
+                     : clockHz <= 400000 ? BUS_FREE_NANOS_FM : BUS_FREE_NANOS_FMP;
+  HostTiming result = { bitNanos, 9 * bitNanos, bitNanos, idleNanos };
+
+  return result;
+}
+
+uint64_t HostBus::nanos() {
+
+  return clockNanos.load();
+}
+
+void HostBus::advance(uint64_t nanos) {
+
+  clockNanos += nanos;
+}
+
+uint8_t *HostBus::regs(uint8_t address) {
+
+  updateInputs(address);
+
+  return registers[address];
+}
+
+void HostBus::setPinLevels(uint8_t address, uint16_t levels) {
+
+  pinLevels[address] = levels;
+}
+
+void HostBus::setOscillator(uint8_t address, int32_t errorPpm, uint64_t originNanos) {
+
+  oscillatorPpm[address] = errorPpm;
+  oscillatorOrigin[address] = originNanos;
+}
+
+uint32_t HostBus::deviceMicros(uint8_t address, uint64_t nanos) {
+
+  if (nanos < oscillatorOrigin[address]) {
+    return 0;
+  }
+
+  uint64_t elapsed = nanos - oscillatorOrigin[address];
+
+  return (elapsed + (int64_t) elapsed * oscillatorPpm[address] / 1000000) / 1000;
+}
+
+void HostBus::setFaults(const HostFaults &faults, uint32_t seed) {
+
+  injected = faults;
+  random32 = seed ? seed : 1;
+}
+
+uint32_t HostBus::bytes() {
+
+  return busBytes;
+}
+
+uint32_t HostBus::transactions() {
+
+  return busTransactions;
+}
+
+uint32_t HostBus::faults() {
+
+  return busFaults;
+}
+
+void HostBus::resetStats() {
+
+  busBytes = 0;
+  busTransactions = 0;
+  busFaults = 0;
+}
+
+const std::vector<HostWrite> &HostBus::log() {
+
+  return writes;
+}
+
+void HostBus::clearLog() {
+
+  writes.clear();
+}
+
+void HostBus::setCapture(FILE *file) {
+
+  captureFile = file;
+}
+
+void HostBus::setVerbose(bool enable) {
+
+  verbose = enable;
+}
+
+bool HostBus::isVerbose() {
+
+  return verbose;
+}
+
+uint8_t HostBus::write(uint8_t address, const uint8_t *data, uint8_t length, bool sendStop) {
+
+  address &= HOST_ADDRESSES - 1;
+
+  if (chance(injected.timeout)) {
+    // the Wire core gives up and resets the bus, no STOP
+    busFaults++;
+    clockNanos += (uint64_t) injected.timeoutMicros * 1000;
+    return 5;
+  }
+
+  start(address, false);
+
+  if (chance(injected.nackAddress)) {
+    busFaults++;
+    transfer(address, false, "address", address << 1, false);
+    stop(address, true);
+    return 2;
+  }
+  transfer(address, false, "address", address << 1, true);
+
+  for (uint8_t i = 0; i < length; i++) {
+
+    if (chance(injected.resetMidBurst)) {
+      // the device restarts and ignores the rest of the burst
+      busFaults++;
+      powerOn(address);
+      HostWrite reset = { clockNanos.load(), address, REG_COUNT, 0xFF };
+      writes.push_back(reset);
+      transfer(address, false, "data", data[i], false);
+      stop(address, true);
+      return 3;
+    }
+
+    if (chance(injected.nackData)) {
+      busFaults++;
+      transfer(address, false, "data", data[i], false);
+      stop(address, true);
+      return 3;
+    }
+
+    transfer(address, false, "data", data[i], true);
+
+    if (i == 0) {
+      // control register: auto-increment flag and register address
+      pointer[address] = data[i] & (AUTO_INCREMENT | 0x0F);
+      continue;
+    }
+
+    uint8_t reg = pointer[address] & 0x0F;
+
+    if (reg >= REG_PSC0 && reg < REG_COUNT) {
+      registers[address][reg] = data[i];
+      HostWrite entry = { clockNanos.load(), address, reg, data[i] };
+      writes.push_back(entry);
+    }
+
+    if (pointer[address] & AUTO_INCREMENT) {
+      pointer[address] = AUTO_INCREMENT | ((reg + 1) % REG_COUNT);
+    }
+  }
+
+  stop(address, sendStop);
+
+  return 0;
+}
+
+uint8_t HostBus::read(uint8_t address, uint8_t *data, uint8_t length, bool sendStop) {
+
+  address &= HOST_ADDRESSES - 1;
+
+  if (chance(injected.timeout)) {
+    busFaults++;
+    clockNanos += (uint64_t) injected.timeoutMicros * 1000;
+    return 0;
+  }
+
+  start(address, true);
+
+  if (chance(injected.nackAddress)) {
+    busFaults++;
+    transfer(address, true, "address", address << 1 | 1, false);
+    stop(address, true);
+    return 0;
+  }
+  transfer(address, true, "address", address << 1 | 1, true);
+
+  updateInputs(address);
+
+  for (uint8_t i = 0; i < length; i++) {
+
+    uint8_t reg = pointer[address] & 0x0F;
+    uint8_t value = reg < REG_COUNT ? registers[address][reg] : 0;
+
+    if (chance(injected.corruptRead)) {
+      busFaults++;
+      value ^= 1 << (random32 & 7);
+    }
+
+    data[i] = value;
+    transfer(address, true, "data", value, i + 1 < length);
+
+    if (pointer[address] & AUTO_INCREMENT) {
+      pointer[address] = AUTO_INCREMENT | ((reg + 1) % REG_COUNT);
+    }
+  }
+
+  stop(address, sendStop);
+
+  return length;
+}
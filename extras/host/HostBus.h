@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef HOSTBUS_H
+#define HOSTBUS_H
+
+#include <vector>
+#include "Wire.h"
+#include "PCA9532.h"
+
+// Number of simulated devices, one per 7 bit address
+#define HOST_ADDRESSES 128
+
+/**
+ * Timing of the simulated bus. idleNanos is the bus free time after a STOP
+ * plus the software overhead of the Wire core until the next START
+ */
+struct HostTiming {
+    uint32_t startNanos;
+    uint32_t byteNanos;
+    uint32_t stopNanos;
+    uint32_t idleNanos;
+};
+
+/**
+ * Fault injection, probabilities from 0 to 1
+ */
+struct HostFaults {
+    double nackAddress;     // NACK of the address byte, per transaction
+    double nackData;        // NACK of a data byte, per byte written
+    double corruptRead;     // Bit flip, per byte read
+    double timeout;         // Bus timeout, per transaction
+    double resetMidBurst;   // Device reset to power-on, per byte written
+    uint32_t timeoutMicros; // Bus time lost by a timeout
+};
+
+/**
+ * Register write seen by a device, the register timeline of the
+ * virtual panel
+ */
+struct HostWrite {
+    uint64_t nanos;   // Bus time the byte was acknowledged
+    uint8_t address;  // Device address
+    uint8_t reg;      // Register address
+    uint8_t value;    // Value written, 0xFF with reg = REG_COUNT for a reset
+};
+
+/**
+ * Simulated I2C bus with PCA9532 devices at every address and a virtual
+ * clock. Registers follow the datasheet: auto-increment rolls over from
+ * LS3 to INPUT0, INPUT0/INPUT1 are read-only and reflect the pins, an
+ * output that is on pulls its pin LOW
+ */
+class HostBus {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Power-on reset of all devices, virtual clock at 0, statistics,
+     * faults, register log and capture cleared, ideal 100kHz timing
+     */
+    static void reset();
+
+    /**
+     * Set the bus timing
+     *
+     * @param timing Bus timing
+     */
+    static void setTiming(const HostTiming &timing);
+
+    /**
+     * Ideal timing for a bus clock, the same as
+     * PCA9532::busProfileForClock()
+     *
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus timing
+     */
+    static HostTiming timingForClock(uint32_t clockHz);
+
+    /**
+     * Virtual clock
+     *
+     * @return nanoseconds since reset()
+     */
+    static uint64_t nanos();
+
+    /**
+     * Advance the virtual clock, e.g. for simulated CPU time
+     *
+     * @param nanos Nanoseconds to advance
+     */
+    static void advance(uint64_t nanos);
+
+    /**
+     * Registers of a device
+     *
+     * @param address Device address
+     *
+     * @return REG_COUNT registers, INPUT0/INPUT1 updated to the current pins
+     */
+    static uint8_t *regs(uint8_t address);
+
+    /**
+     * Set the levels external circuitry drives on the pins of a device
+     * (default all HIGH through pull-ups)
+     *
+     * @param address Device address
+     * @param levels  Bit n = level of pin LEDn
+     */
+    static void setPinLevels(uint8_t address, uint16_t levels);
+
+    /**
+     * Set the blink oscillator of a device: frequency error and time the
+     * blink timebase started (default exact, started at reset())
+     *
+     * @param address     Device address
+     * @param errorPpm    Frequency error in parts per million
+     * @param originNanos Bus time the timebase started
+     */
+    static void setOscillator(uint8_t address, int32_t errorPpm, uint64_t originNanos);
+
+    /**
+     * Device time of the blink timebase at a bus time
+     *
+     * @param address Device address
+     * @param nanos   Bus time
+     *
+     * @return microseconds since the timebase started, in device time
+     */
+    static uint32_t deviceMicros(uint8_t address, uint64_t nanos);
+
+    /**
+     * Set the faults to inject
+     *
+     * @param faults Fault probabilities
+     * @param seed   Seed of the random generator
+     */
+    static void setFaults(const HostFaults &faults, uint32_t seed = 1);
+
+    /**
+     * Bytes on the bus since the last resetStats(), address bytes included
+     *
+     * @return bytes
+     */
+    static uint32_t bytes();
+
+    /**
+     * Transactions (START to STOP) since the last resetStats()
+     *
+     * @return transactions
+     */
+    static uint32_t transactions();
+
+    /**
+     * Injected faults since the last resetStats()
+     *
+     * @return faults
+     */
+    static uint32_t faults();
+
+    /**
+     * Reset the bus statistics
+     */
+    static void resetStats();
+
+    /**
+     * Register writes since reset() or clearLog(), in bus order
+     *
+     * @return register timeline of all devices
+     */
+    static const std::vector<HostWrite> &log();
+
+    /**
+     * Clear the register log
+     */
+    static void clearLog();
+
+    /**
+     * Write every bus event to a CSV file in the format of a logic analyser
+     * export (see extras/calibrate_bus.py)
+     *
+     * @param capture Open file, NULL to stop capturing
+     */
+    static void setCapture(FILE *capture);
+
+    /**
+     * Print Serial output of sketches to stdout
+     *
+     * @param verbose true to print
+     */
+    static void setVerbose(bool verbose);
+
+    /**
+     * Check if Serial output is printed
+     *
+     * @return true if printed
+     */
+    static bool isVerbose();
+
+    /**
+     * Write transaction, called by TwoWire::endTransmission()
+     *
+     * @param address  Device address
+     * @param data     Bytes after the address byte
+     * @param length   Number of bytes
+     * @param sendStop false for a repeated START to follow
+     *
+     * @return Wire status code
+     */
+    static uint8_t write(uint8_t address, const uint8_t *data, uint8_t length, bool sendStop);
+
+    /**
+     * Read transaction, called by TwoWire::requestFrom()
+     *
+     * @param address  Device address
+     * @param data     Buffer for the bytes read
+     * @param length   Number of bytes to read
+     * @param sendStop false for a repeated START to follow
+     *
+     * @return number of bytes read
+     */
+    static uint8_t read(uint8_t address, uint8_t *data, uint8_t length, bool sendStop);
+};
+
+#endif //HOSTBUS_H
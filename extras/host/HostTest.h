@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Checks and measurements shared by the host tests. Every test is a
+ * program of its own, it prints its results and exits with 1 if a check
+ * failed (see run_tests.sh)
+ */
+
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "HostBus.h"
+
+static int hostFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            hostFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        long long a_ = (long long) (actual), e_ = (long long) (expected); \
+        if (a_ != e_) { \
+            printf("%s:%d: check failed: %s == %lld, expected %lld\n", \
+                   __FILE__, __LINE__, #actual, a_, e_); \
+            hostFailures++; \
+        } \
+    } while (0)
+
+/**
+ * Print the test result
+ *
+ * @param name Name of the test
+ *
+ * @return exit code of the test
+ */
+static inline int hostResult(const char *name) {
+
+  printf("%s: %s\n", name, hostFailures ? "FAILED" : "ok");
+
+  return hostFailures ? 1 : 0;
+}
+
+/**
+ * CPU time of the calling thread, independent of the virtual clock
+ *
+ * @return nanoseconds
+ */
+static inline uint64_t hostCpuNanos() {
+
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Keep a value alive so the compiler cannot drop the work producing it
+ */
+template <typename T>
+static inline void hostKeep(const T &value) {
+
+  __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Median of samples with the median absolute deviation and a distribution
+ * free 95% confidence interval of the median (order statistics)
+ */
+struct HostStats {
+    double min;
+    double median;
+    double mad;
+    double low;
+    double high;
+};
+
+/**
+ * Summarize samples
+ *
+ * @param samples Samples, sorted on return
+ *
+ * @return statistics
+ */
+static inline HostStats hostStats(std::vector<double> &samples) {
+
+  HostStats stats = { 0, 0, 0, 0, 0 };
+  size_t n = samples.size();
+
+  if (n == 0) {
+    return stats;
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  std::vector<double> deviations;
+  double median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  for (size_t i = 0; i < n; i++) {
+    deviations.push_back(fabs(samples[i] - median));
+  }
+  std::sort(deviations.begin(), deviations.end());
+
+  // ranks n/2 -+ 1.96 sqrt(n)/2 bound the median with 95% confidence
+  double spread = 0.98 * sqrt((double) n);
+  long low = (long) floor(n / 2.0 - spread);
+  long high = (long) ceil(n / 2.0 + spread);
+
+  stats.min = samples[0];
+  stats.median = median;
+  stats.mad = deviations[n / 2];
+  stats.low = samples[low < 0 ? 0 : low];
+  stats.high = samples[high >= (long) n ? n - 1 : high];
+
+  return stats;
+}
+
+/**
+ * Microbenchmark of a function: the batch size is calibrated to about
+ * 200us of CPU time, then 31 batches are measured after a warm-up
+ *
+ * @param name Name to print
+ * @param body Function doing one call
+ *
+ * @return statistics of the CPU time per call in nanoseconds
+ */
+template <typename Body>
+static HostStats hostBench(const char *name, Body body) {
+
+  uint32_t batch = 1;
+
+  for (;;) {
+    uint64_t start = hostCpuNanos();
+    for (uint32_t i = 0; i < batch; i++) {
+      body(i);
+    }
+    if (hostCpuNanos() - start > 200000 || batch >= (1UL << 24)) {
+      break;
+    }
+    batch *= 2;
+  }
+
+  std::vector<double> samples;
+
+  for (uint8_t s = 0; s < 31; s++) {
+    uint64_t start = hostCpuNanos();
+    for (uint32_t i = 0; i < batch; i++) {
+      body(i);
+    }
+    samples.push_back((double) (hostCpuNanos() - start) / batch);
+  }
+
+  HostStats stats = hostStats(samples);
+
+  printf("  %-40s %9.2f ns  (min %.2f, MAD %.2f, 95%% CI %.2f..%.2f)\n",
+         name, stats.median, stats.min, stats.mad, stats.low, stats.high);
+
+  return stats;
+}
+
+#endif //HOSTTEST_H
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Stand-in for the PCA9622 library used by examples/ApiExample_9622.ino.
+ * The PCA9622 is not simulated, its calls do nothing so that only the
+ * PCA9532 traffic is measured
+ */
+
+#ifndef PCA9622_H
+#define PCA9622_H
+
+#include <Wire.h>
+
+#define REG_PWM2 0x04
+
+#define LDR_STATE_IND_GRP 0x03
+
+#define GROUP_CONTROL_MODE_DIMMING 0x00
+
+class PCA9622 {
+public:
+    PCA9622(uint8_t, uint8_t, uint8_t) {}
+    void begin(uint8_t, TwoWire *) {}
+    void setLdrStateAll(uint8_t) {}
+    void setGroupControlMode(uint8_t) {}
+    void setGrpPwm(uint8_t) {}
+    void setRGB(uint8_t, uint8_t, uint8_t) {}
+};
+
+#endif //PCA9622_H
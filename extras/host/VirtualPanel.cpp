@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+#include "VirtualPanel.h"
+#include "PCA9532Panel.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor, the device is at the power-on defaults since reset()
+     *
+     * @param address Device address
+     */
+VirtualPanel::VirtualPanel(uint8_t address) : _address(address), _logged(0) {
+
+  // power-on register values (page 6, table 3)
+  Segment powerOn;
+  powerOn.nanos = 0;
+  memset(powerOn.regs, 0, REG_COUNT);
+  powerOn.regs[REG_PWM0] = 0x80;
+  powerOn.regs[REG_PWM1] = 0x80;
+  _segments.push_back(powerOn);
+}
+
+    /**
+     * Append the register writes logged by the bus since the last update()
+     */
+void VirtualPanel::update() {
+
+  const std::vector<HostWrite> &log = HostBus::log();
+
+  if (_logged > log.size()) {
+    // the log was cleared, continue with what follows
+    _logged = 0;
+  }
+
+  for (; _logged < log.size(); _logged++) {
+    const HostWrite &write = log[_logged];
+    if (write.address != _address) {
+      continue;
+    }
+
+    Segment next = _segments.back();
+    next.nanos = write.nanos;
+    if (write.reg == REG_COUNT) {
+      next = _segments.front();
+      next.nanos = write.nanos;
+    } else if (write.reg >= REG_PSC0) {
+      next.regs[write.reg] = write.value;
+    }
+
+    if (next.nanos == _segments.back().nanos) {
+      _segments.back() = next;
+    } else {
+      _segments.push_back(next);
+    }
+  }
+}
+
+    /**
+     * Register image at a bus time
+     *
+     * @param nanos    Bus time
+     * @param regImage Buffer for REG_COUNT registers
+     */
+void VirtualPanel::image(uint64_t nanos, uint8_t *regImage) const {
+
+  memcpy(regImage, _segments[segmentAt(nanos)].regs, REG_COUNT);
+}
+
+    /**
+     * Instantaneous brightness of an output
+     *
+     * @param output Output LED0 to LED15
+     * @param nanos  Bus time
+     *
+     * @return 255 if the LED is on, 0 if it is off
+     */
+uint8_t VirtualPanel::level(uint8_t output, uint64_t nanos) const {
+
+  return PCA9532Panel::outputLevel(_segments[segmentAt(nanos)].regs, output,
+                                   HostBus::deviceMicros(_address, nanos));
+}
+
+    /**
+     * Time-averaged brightness of an output across all register changes
+     * within a window
+     *
+     * @param output     Output LED0 to LED15
+     * @param startNanos Start of the window
+     * @param endNanos   End of the window
+     *
+     * @return brightness 0 to 255
+     */
+uint8_t VirtualPanel::brightness(uint8_t output, uint64_t startNanos, uint64_t endNanos) const {
+
+  uint32_t start = HostBus::deviceMicros(_address, startNanos);
+  uint32_t end = HostBus::deviceMicros(_address, endNanos);
+
+  if (end <= start) {
+    return level(output, startNanos);
+  }
+
+  uint64_t on = 0;
+
+  for (size_t i = segmentAt(startNanos); i < _segments.size() && _segments[i].nanos < endNanos; i++) {
+    // the part of the window this image was in effect, in device time
+    uint32_t from = start;
+    uint32_t to = end;
+    if (_segments[i].nanos > startNanos) {
+      from = HostBus::deviceMicros(_address, _segments[i].nanos);
+    }
+    if (i + 1 < _segments.size() && _segments[i + 1].nanos < endNanos) {
+      to = HostBus::deviceMicros(_address, _segments[i + 1].nanos);
+    }
+    if (to > from) {
+      on += PCA9532Panel::onMicros(_segments[i].regs, output, to)
+            - PCA9532Panel::onMicros(_segments[i].regs, output, from);
+    }
+  }
+
+  return on * 255 / (end - start);
+}
+
+    /**
+     * Time-averaged brightness of all outputs per frame. Frame n covers
+     * startNanos + n * frameNanos + settleNanos up to the start of frame
+     * n + 1, settleNanos skips the bus time of the frame's own writes
+     *
+     * @param startNanos  Start of the first frame
+     * @param frameNanos  Frame duration
+     * @param settleNanos Time skipped at the start of every frame
+     * @param frames      Number of frames
+     * @param levels      Buffer for frames rows of PANEL_OUTPUTS levels
+     */
+void VirtualPanel::frames(uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                          uint16_t frames, uint8_t *levels) const {
+
+  for (uint16_t frame = 0; frame < frames; frame++) {
+    uint64_t start = startNanos + frame * frameNanos;
+    for (uint8_t output = 0; output < PANEL_OUTPUTS; output++) {
+      levels[frame * PANEL_OUTPUTS + output] = brightness(output, start + settleNanos, start + frameNanos);
+    }
+  }
+}
+
+    /**
+     * Write frames as CSV, one row per frame: start time in microseconds
+     * and the brightness of LED0 to LED15
+     *
+     * @param file   Open file
+     * @param others Same arguments as frames()
+     */
+void VirtualPanel::writeCsv(FILE *file, uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                            uint16_t frames) const {
+
+  std::vector<uint8_t> levels(frames * PANEL_OUTPUTS);
+  this->frames(startNanos, frameNanos, settleNanos, frames, levels.data());
+
+  fprintf(file, "micros");
+  for (uint8_t output = 0; output < PANEL_OUTPUTS; output++) {
+    fprintf(file, ",led%u", output);
+  }
+  fprintf(file, "\n");
+
+  for (uint16_t frame = 0; frame < frames; frame++) {
+    fprintf(file, "%llu", (unsigned long long) ((startNanos + frame * frameNanos) / 1000));
+    for (uint8_t output = 0; output < PANEL_OUTPUTS; output++) {
+      fprintf(file, ",%u", levels[frame * PANEL_OUTPUTS + output]);
+    }
+    fprintf(file, "\n");
+  }
+}
+
+    /**
+     * Write frames as a plain PPM strip: one grey pixel per output, one
+     * row per frame
+     *
+     * @param file   Open file
+     * @param others Same arguments as frames()
+     */
+void VirtualPanel::writePpm(FILE *file, uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                            uint16_t frames) const {
+
+  std::vector<uint8_t> levels(frames * PANEL_OUTPUTS);
+  this->frames(startNanos, frameNanos, settleNanos, frames, levels.data());
+
+  fprintf(file, "P3\n%u %u\n255\n", PANEL_OUTPUTS, frames);
+
+  for (uint16_t frame = 0; frame < frames; frame++) {
+    for (uint8_t output = 0; output < PANEL_OUTPUTS; output++) {
+      uint8_t level = levels[frame * PANEL_OUTPUTS + output];
+      fprintf(file, "%s%u %u %u", output ? "  " : "", level, level, level);
+    }
+    fprintf(file, "\n");
+  }
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Index of the segment in effect at a bus time
+     *
+     * @param nanos Bus time
+     *
+     * @return segment index
+     */
+size_t VirtualPanel::segmentAt(uint64_t nanos) const {
+
+  size_t low = 0, high = _segments.size();
+
+  // last segment starting at or before nanos, the first one starts at 0
+  while (high - low > 1) {
+    size_t middle = (low + high) / 2;
+    if (_segments[middle].nanos <= nanos) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef VIRTUALPANEL_H
+#define VIRTUALPANEL_H
+
+#include <stdio.h>
+#include <vector>
+#include "HostBus.h"
+
+#define PANEL_OUTPUTS 16 // LED0 to LED15
+
+/**
+ * What the LEDs of a simulated device looked like over time. The register
+ * timeline is replayed from the write log of the bus, the brightness of an
+ * output follows its LS state and the PSC/PWM blink of the device timebase
+ * (see HostBus::setOscillator()). Frames of time-averaged brightness can be
+ * exported as CSV or PPM strips for golden comparisons
+ */
+class VirtualPanel {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor, the device is at the power-on defaults since reset()
+     *
+     * @param address Device address
+     */
+    explicit VirtualPanel(uint8_t address);
+
+    /**
+     * Append the register writes logged by the bus since the last update()
+     */
+    void update();
+
+    /**
+     * Register image at a bus time
+     *
+     * @param nanos    Bus time
+     * @param regImage Buffer for REG_COUNT registers
+     */
+    void image(uint64_t nanos, uint8_t *regImage) const;
+
+    /**
+     * Instantaneous brightness of an output
+     *
+     * @param output Output LED0 to LED15
+     * @param nanos  Bus time
+     *
+     * @return 255 if the LED is on, 0 if it is off
+     */
+    uint8_t level(uint8_t output, uint64_t nanos) const;
+
+    /**
+     * Time-averaged brightness of an output across all register changes
+     * within a window
+     *
+     * @param output     Output LED0 to LED15
+     * @param startNanos Start of the window
+     * @param endNanos   End of the window
+     *
+     * @return brightness 0 to 255
+     */
+    uint8_t brightness(uint8_t output, uint64_t startNanos, uint64_t endNanos) const;
+
+    /**
+     * Time-averaged brightness of all outputs per frame. Frame n covers
+     * startNanos + n * frameNanos + settleNanos up to the start of frame
+     * n + 1, settleNanos skips the bus time of the frame's own writes
+     *
+     * @param startNanos  Start of the first frame
+     * @param frameNanos  Frame duration
+     * @param settleNanos Time skipped at the start of every frame
+     * @param frames      Number of frames
+     * @param levels      Buffer for frames rows of PANEL_OUTPUTS levels
+     */
+    void frames(uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                uint16_t frames, uint8_t *levels) const;
+
+    /**
+     * Write frames as CSV, one row per frame: start time in microseconds
+     * and the brightness of LED0 to LED15
+     *
+     * @param file   Open file
+     * @param others Same arguments as frames()
+     */
+    void writeCsv(FILE *file, uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                  uint16_t frames) const;
+
+    /**
+     * Write frames as a plain PPM strip: one grey pixel per output, one
+     * row per frame
+     *
+     * @param file   Open file
+     * @param others Same arguments as frames()
+     */
+    void writePpm(FILE *file, uint64_t startNanos, uint64_t frameNanos, uint64_t settleNanos,
+                  uint16_t frames) const;
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Register image from a bus time until the next change
+     */
+    struct Segment {
+        uint64_t nanos;
+        uint8_t regs[REG_COUNT];
+    };
+
+    /**
+     * Device address
+     */
+    uint8_t _address;
+
+    /**
+     * Register timeline, sorted by time, and the number of log entries
+     * replayed into it
+     */
+    std::vector<Segment> _segments;
+    size_t _logged;
+
+    /**
+     * Index of the segment in effect at a bus time
+     *
+     * @param nanos Bus time
+     *
+     * @return segment index
+     */
+    size_t segmentAt(uint64_t nanos) const;
+};
+
+#endif //VIRTUALPANEL_H
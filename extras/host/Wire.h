@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Host stub of the Arduino Wire library, backed by the simulated bus in
+ * HostBus.cpp. Return codes of endTransmission() follow the AVR core:
+ * 0 success, 2 NACK on address, 3 NACK on data, 5 timeout
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "Arduino.h"
+
+#define WIRE_BUFFER_LENGTH 32
+
+class TwoWire {
+public:
+    TwoWire();
+    void begin();
+    void setClock(uint32_t clockHz);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = 1);
+    int available();
+    int read();
+
+private:
+    uint8_t _address;
+    uint8_t _tx[WIRE_BUFFER_LENGTH];
+    uint8_t _txLength;
+    uint8_t _rx[WIRE_BUFFER_LENGTH];
+    uint8_t _rxLength;
+    uint8_t _rxIndex;
+};
+
+extern TwoWire Wire;
+
+#endif //WIRE_H
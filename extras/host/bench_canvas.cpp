@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Canvas of 16x16 pixels over 18 serpentine wired devices with LED15 not
+ * connected: CPU time, bus bytes and bus time per frame of draw plus flush
+ */
+
+#include "HostTest.h"
+#include "PCA9532Canvas.h"
+
+#define WIDTH   16
+#define HEIGHT  16
+#define DEVICES 18
+
+int main() {
+
+  HostBus::reset();
+  HostBus::setTiming(HostBus::timingForClock(400000));
+
+  static PCA9532Fleet fleet(&Wire);
+  static PCA9532Pixel layout[WIDTH * HEIGHT];
+
+  fleet.begin();
+  for (uint8_t d = 0; d < DEVICES; d++) {
+    fleet.addDevice(0x40 + d);
+  }
+  // a mask without any connected output maps nothing
+  CHECK_EQ(PCA9532Canvas::buildSerpentine(layout, WIDTH, HEIGHT, 0, 0xFFFF), 0);
+  CHECK_EQ(layout[WIDTH * HEIGHT - 1].output, CANVAS_NO_OUTPUT);
+
+  CHECK_EQ(PCA9532Canvas::buildSerpentine(layout, WIDTH, HEIGHT, 0, 1 << 15), WIDTH * HEIGHT);
+  PCA9532Canvas canvas(&fleet, layout, WIDTH, HEIGHT);
+
+  // pixel (x, y) lands on the output given by the serpentine wiring
+  canvas.setPixel(3, 1, LS_STATE_ON);
+  canvas.flush();
+  uint16_t index = 1 * WIDTH + (WIDTH - 1 - 3); // second row runs right to left
+  uint8_t device = index / 15, output = index % 15;
+  CHECK_EQ(HostBus::regs(0x40 + device)[REG_LS0 + (output >> 2)], LS_STATE_ON << ((output & 3) << 1));
+  CHECK_EQ(HostBus::regs(0x40 + device + 1)[REG_LS0], 0);
+
+  printf("canvas %dx%d, %d devices, per frame\n", WIDTH, HEIGHT, DEVICES);
+
+  struct Scene {
+    const char *name;
+    void (*draw)(PCA9532Canvas &canvas, uint32_t frame);
+  };
+  static const Scene SCENES[] = {
+    { "one pixel moving", [](PCA9532Canvas &c, uint32_t f) {
+        c.setPixel((f - 1) % WIDTH, 8, LS_STATE_OFF);
+        c.setPixel(f % WIDTH, 8, LS_STATE_ON);
+      } },
+    { "rotating line", [](PCA9532Canvas &c, uint32_t f) {
+        c.fill(LS_STATE_OFF);
+        c.line(f % WIDTH, 0, WIDTH - 1 - f % WIDTH, HEIGHT - 1, LS_STATE_ON);
+      } },
+    { "growing rectangles", [](PCA9532Canvas &c, uint32_t f) {
+        c.fill(LS_STATE_OFF);
+        uint8_t size = f % 8;
+        c.rect(8 - size, 8 - size, 2 * size, 2 * size, LS_STATE_ON);
+        c.fillRect(7, 7, 2, 2, LS_STATE_BLNK0);
+      } },
+    { "full frame inverted", [](PCA9532Canvas &c, uint32_t f) {
+        c.fill(f & 1 ? LS_STATE_ON : LS_STATE_OFF);
+      } },
+  };
+
+  for (uint8_t s = 0; s < sizeof(SCENES) / sizeof(SCENES[0]); s++) {
+
+    const Scene &scene = SCENES[s];
+
+    HostBus::resetStats();
+    uint64_t start = HostBus::nanos();
+    for (uint32_t f = 1; f <= 100; f++) {
+      scene.draw(canvas, f);
+      canvas.flush();
+    }
+    printf("  %-22s %5u bus bytes, %7.1f us bus time\n", scene.name,
+           HostBus::bytes() / 100, (HostBus::nanos() - start) / 100 / 1000.0);
+
+    hostBench(scene.name, [&](uint32_t f) {
+      scene.draw(canvas, f);
+      canvas.flush();
+    });
+    CHECK(!fleet.isPending());
+  }
+
+  return hostResult("bench_canvas");
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Replay of examples/ApiExample_9622.ino on the simulated bus: bus bytes,
+ * transactions, bus time and CPU time per loop() iteration. delay() only
+ * advances the virtual clock, so the CPU time is the work of the driver
+ * plus the simulated bus, without the waiting
+ */
+
+#include "HostTest.h"
+
+#include "../../examples/ApiExample_9622.ino"
+
+#define LOOPS 20
+
+int main() {
+
+  HostBus::reset();
+
+  setup();
+
+  printf("examples/ApiExample_9622.ino, per loop()\n");
+
+  std::vector<double> cpu;
+  uint32_t firstBytes = 0;
+
+  for (uint8_t i = 0; i < LOOPS; i++) {
+
+    uint32_t bytes = HostBus::bytes();
+    uint32_t transactions = HostBus::transactions();
+    uint64_t start = HostBus::nanos();
+    uint64_t cpuStart = hostCpuNanos();
+
+    loop();
+
+    cpu.push_back((double) (hostCpuNanos() - cpuStart));
+
+    bytes = HostBus::bytes() - bytes;
+    transactions = HostBus::transactions() - transactions;
+
+    // the driver counts exactly what went over the bus
+    CHECK_EQ(pca9532_1.getBusBytes() + pca9532_2.getBusBytes(), bytes);
+    CHECK_EQ(pca9532_1.getBusTransactions() + pca9532_2.getBusTransactions(), transactions);
+
+    // every iteration does the same work
+    firstBytes = i ? firstBytes : bytes;
+    CHECK_EQ(bytes, firstBytes);
+
+    if (i == 0) {
+      uint32_t busMicros = pca9532_1.estimateBusMicros(transactions, bytes);
+      printf("  %u bus bytes, %u transactions, %.1f ms on the bus of %.1f s\n",
+             bytes, transactions, busMicros / 1e3, (HostBus::nanos() - start) / 1e9);
+    }
+  }
+
+  HostStats stats = hostStats(cpu);
+  printf("  CPU time %.1f us (min %.1f, MAD %.1f) over %d iterations\n",
+         stats.median / 1000, stats.min / 1000, stats.mad / 1000, LOOPS);
+
+  return hostResult("bench_example");
+}
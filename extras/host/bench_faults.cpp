@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Bus faults: how frame rate and correctness degrade with the fault rate,
+ * without retries, with flush() retries and with a resync() after an
+ * error. Direct writes such as setPwm() are never retried
+ */
+
+#include "HostTest.h"
+
+#define ADDRESS 0x62
+#define FRAMES  2000
+
+struct FaultResult {
+    double frameMicros;  // Virtual time per frame
+    double correct;      // Frames the device showed as intended, in percent
+    uint32_t busErrors;  // Transactions that failed after all retries
+};
+
+// frames of changing PWM and LS values, the device is compared with the
+// driver image after every frame
+static FaultResult stream(double rate, uint8_t retries, bool resync) {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+  pca9532.setRetries(retries);
+
+  // a NACK or timeout per transaction, rarer byte faults and resets
+  HostFaults faults = { rate, rate / 8, 0, rate / 10, rate / 100, 1000 };
+  HostBus::setFaults(faults, 7);
+
+  uint64_t start = HostBus::nanos();
+  uint32_t correct = 0;
+  uint32_t value = 1;
+
+  for (uint16_t frame = 0; frame < FRAMES; frame++) {
+    for (uint8_t reg = REG_PWM0; reg < REG_COUNT; reg++) {
+      if (reg == REG_PSC1) {
+        continue;
+      }
+      value = value * 1103515245 + 12345;
+      pca9532.queueReg(reg, value >> 24);
+    }
+    uint32_t errors = pca9532.getBusErrors();
+    pca9532.flush();
+    if (resync && pca9532.getBusErrors() != errors) {
+      pca9532.resync();
+    }
+
+    const uint8_t *regs = HostBus::regs(ADDRESS);
+    bool same = true;
+    for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg++) {
+      same &= regs[reg] == pca9532.getRegImage(reg);
+    }
+    correct += same;
+  }
+
+  FaultResult result;
+  result.frameMicros = (HostBus::nanos() - start) / 1000.0 / FRAMES;
+  result.correct = 100.0 * correct / FRAMES;
+  result.busErrors = pca9532.getBusErrors();
+
+  return result;
+}
+
+int main() {
+
+  // a failed direct write is one attempt and leaves nothing pending
+  HostBus::reset();
+  {
+    PCA9532 pca9532(REG_PWM0, REG_PWM1);
+    pca9532.begin(ADDRESS, &Wire);
+    HostFaults nack = { 1, 0, 0, 0, 0, 0 };
+    HostBus::setFaults(nack);
+    pca9532.resetBusStats();
+    pca9532.setPwm(REG_PWM0, 0x40);
+    CHECK_EQ(pca9532.getBusBytes(), 3);
+    CHECK_EQ(pca9532.getBusErrors(), 1);
+    CHECK(!pca9532.isPending(PRIORITY_BULK));
+    CHECK(!pca9532.isPending(PRIORITY_HIGH));
+
+    // a failed flush burst is retried and stays pending
+    pca9532.resetBusStats();
+    pca9532.queueReg(REG_PWM1, 0x40);
+    pca9532.flush();
+    CHECK_EQ(pca9532.getBusBytes(), 3 * (1 + BUS_RETRIES));
+    CHECK(pca9532.isPending(PRIORITY_BULK));
+  }
+
+  static const double rates[] = { 0, 0.001, 0.01, 0.05, 0.1 };
+
+  printf("bus faults, %u frames of 7 registers at 100kHz\n", FRAMES);
+  printf("  fault rate    no retries          %u retries           retries + resync\n", BUS_RETRIES);
+
+  for (uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+    FaultResult none = stream(rates[i], 0, false);
+    FaultResult retried = stream(rates[i], BUS_RETRIES, false);
+    FaultResult resynced = stream(rates[i], BUS_RETRIES, true);
+
+    printf("  %5.1f%%   %6.0fus %6.2f%% ok   %6.0fus %6.2f%% ok   %6.0fus %6.2f%% ok\n",
+           rates[i] * 100, none.frameMicros, none.correct, retried.frameMicros, retried.correct,
+           resynced.frameMicros, resynced.correct);
+
+    if (rates[i] == 0) {
+      CHECK(none.correct == 100 && retried.correct == 100 && resynced.correct == 100);
+      CHECK_EQ(none.busErrors, 0);
+    } else {
+      // retries trade bus time for frames that arrive intact
+      CHECK(retried.correct >= none.correct);
+      CHECK(resynced.correct >= retried.correct);
+      CHECK(retried.frameMicros >= none.frameMicros);
+    }
+    if (rates[i] == 0.01) {
+      CHECK(retried.correct >= 95);
+    }
+  }
+
+  return hostResult("bench_faults");
+}
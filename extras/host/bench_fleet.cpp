@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Fleet of 64 devices: structure-of-arrays storage with a dirty bitmap
+ * against one PCA9532 object per device, for a few to all devices pending
+ */
+
+#include "HostTest.h"
+#include "PCA9532Fleet.h"
+
+#define DEVICES 64
+
+int main() {
+
+  HostBus::reset();
+  HostBus::setTiming(HostBus::timingForClock(400000));
+
+  static PCA9532Fleet fleet(&Wire);
+  static PCA9532 *objects[DEVICES];
+
+  fleet.begin();
+  for (uint8_t d = 0; d < DEVICES; d++) {
+    CHECK_EQ(fleet.addDevice(d), d);
+    objects[d] = new PCA9532(REG_PWM0, REG_PWM1);
+    objects[d]->begin(d, &Wire);
+  }
+  CHECK_EQ(fleet.addDevice(DEVICES), FLEET_NO_DEVICE);
+
+  // same updates through both layouts land in the same registers: the
+  // register files after the fleet and after the objects are compared
+  static uint8_t viaFleet[DEVICES][REG_COUNT];
+  for (uint8_t d = 0; d < DEVICES; d += 5) {
+    fleet.setReg(d, REG_LS1, d);
+    fleet.setReg(d, REG_PWM0, 3 * d);
+  }
+  for (uint8_t d = 0; d < DEVICES; d += 7) {
+    fleet.setReg(d, REG_LS3, 0x55);
+  }
+  fleet.flush();
+  CHECK(!fleet.isPending());
+  for (uint8_t d = 0; d < DEVICES; d++) {
+    memcpy(viaFleet[d], HostBus::regs(d), REG_COUNT);
+    CHECK_EQ(viaFleet[d][REG_LS1], d % 5 ? 0 : d);
+  }
+
+  HostBus::reset();
+  HostBus::setTiming(HostBus::timingForClock(400000));
+  for (uint8_t d = 0; d < DEVICES; d += 5) {
+    objects[d]->queueReg(REG_LS1, d);
+    objects[d]->queueReg(REG_PWM0, 3 * d);
+  }
+  for (uint8_t d = 0; d < DEVICES; d += 7) {
+    objects[d]->queueReg(REG_LS3, 0x55);
+  }
+  for (uint8_t d = 0; d < DEVICES; d++) {
+    objects[d]->flush();
+    CHECK(memcmp(viaFleet[d] + REG_PSC0, HostBus::regs(d) + REG_PSC0, REG_COUNT - REG_PSC0) == 0);
+  }
+
+  printf("fleet flush of %d devices, CPU time per flush including the simulated bus\n", DEVICES);
+
+  static const uint8_t PENDING[] = { 1, 8, 64 };
+  for (uint8_t p = 0; p < 3; p++) {
+
+    uint8_t pending = PENDING[p];
+    uint8_t stride = DEVICES / pending;
+    char name[64];
+
+    snprintf(name, sizeof(name), "structure of arrays, %2u pending", pending);
+    hostBench(name, [&](uint32_t i) {
+      for (uint8_t d = 0; d < DEVICES; d += stride) {
+        fleet.setReg(d, REG_LS0, i);
+      }
+      fleet.flush();
+    });
+
+    snprintf(name, sizeof(name), "object per device,   %2u pending", pending);
+    hostBench(name, [&](uint32_t i) {
+      for (uint8_t d = 0; d < DEVICES; d += stride) {
+        objects[d]->queueReg(REG_LS0, i);
+      }
+      for (uint8_t d = 0; d < DEVICES; d++) {
+        objects[d]->flush();
+      }
+    });
+  }
+
+  return hostResult("bench_fleet");
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Lookahead planner: bus bytes of jittered scenes planned frame by frame
+ * (window 1) and with longer windows, all under the same maximum error
+ */
+
+#include "HostTest.h"
+#include "PCA9532Lookahead.h"
+
+#define FRAMES    300
+#define MAX_ERROR 8
+#define SCENES    4
+
+static uint8_t levels[FRAMES][LOOKAHEAD_OUTPUTS];
+static uint8_t images[FRAMES][REG_COUNT];
+
+// two groups ramping at their own pace, a few outputs off or on, every
+// level jittering by up to +-3
+static void scene(uint32_t seed) {
+
+  uint32_t random = seed;
+
+  for (uint16_t f = 0; f < FRAMES; f++) {
+    for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+      random = random * 1103515245 + 12345;
+      int16_t jitter = (int16_t) ((random >> 16) % 7) - 3;
+      int16_t level;
+      if (o < 6) {
+        level = 40 + (f * (seed + 1) / 4) % 160;
+      } else if (o < 12) {
+        level = 220 - (f * (seed + 2) / 5) % 120;
+      } else {
+        level = (o & 1) ? 255 : 0;
+        jitter = 0;
+      }
+      level += jitter;
+      levels[f][o] = level < 0 ? 0 : level > 255 ? 255 : level;
+    }
+  }
+}
+
+// largest brightness error of the planned images
+static uint8_t worstError() {
+
+  uint8_t worst = 0;
+
+  for (uint16_t f = 0; f < FRAMES; f++) {
+    for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+      uint8_t state = (images[f][REG_LS0 + o / 4] >> (2 * (o % 4))) & 0x03;
+      uint8_t value = state == LS_STATE_OFF ? 0 : state == LS_STATE_ON ? 255
+                    : (uint16_t) images[f][state == LS_STATE_BLNK0 ? REG_PWM0 : REG_PWM1] * 255 / 256;
+      uint8_t error = levels[f][o] > value ? levels[f][o] - value : value - levels[f][o];
+      worst = error > worst ? error : worst;
+    }
+  }
+
+  return worst;
+}
+
+int main() {
+
+  printf("lookahead, %u jittered frames per scene, maximum error %u\n", FRAMES, MAX_ERROR);
+  printf("  scene");
+  for (uint8_t w = 1; w <= PCA9532_LOOKAHEAD_MAX_WINDOW; w++) {
+    printf("  window %u", w);
+  }
+  printf("\n");
+
+  uint32_t sum[PCA9532_LOOKAHEAD_MAX_WINDOW + 1] = { 0 };
+
+  for (uint8_t s = 0; s < SCENES; s++) {
+    scene(s);
+    printf("  %5u", s);
+    uint32_t bytes[PCA9532_LOOKAHEAD_MAX_WINDOW + 1];
+    for (uint8_t w = 1; w <= PCA9532_LOOKAHEAD_MAX_WINDOW; w++) {
+      bytes[w] = PCA9532Lookahead::plan(levels, FRAMES, w, MAX_ERROR, images);
+      sum[w] += bytes[w];
+      printf("  %8lu", (unsigned long) bytes[w]);
+      CHECK(worstError() <= MAX_ERROR);
+    }
+    printf("\n");
+    CHECK(bytes[PCA9532_LOOKAHEAD_MAX_WINDOW] <= bytes[1]);
+  }
+
+  printf("  total");
+  for (uint8_t w = 1; w <= PCA9532_LOOKAHEAD_MAX_WINDOW; w++) {
+    printf("  %8lu", (unsigned long) sum[w]);
+  }
+  printf("\n");
+  CHECK(sum[PCA9532_LOOKAHEAD_MAX_WINDOW] < sum[1]);
+
+  return hostResult("bench_lookahead");
+}
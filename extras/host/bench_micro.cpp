@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * CPU cost of the pure-compute hot paths, the host side of
+ * examples/CpuBenchmark.ino: LS packing (also the code the fleet, worker,
+ * crossfade, seven-segment and lookahead layers run), brightness model,
+ * bus cost model and frame planning. No bus traffic is measured
+ */
+
+#include "HostTest.h"
+#include "PCA9532Budget.h"
+#include "PCA9532Fleet.h"
+#include "PCA9532Lookahead.h"
+#include "PCA9532Panel.h"
+
+static const uint8_t image[REG_COUNT] = { 0x00, 0x00, 0x00, 0x40, 0x00, 0xC0, 0x1B, 0xE4, 0x55, 0xAA };
+static uint8_t show[4][LOOKAHEAD_OUTPUTS];
+static uint8_t planned[4][REG_COUNT];
+
+int main() {
+
+  // the packing matches the shift/mask chain it replaced
+  for (uint16_t reg = 0; reg < 256; reg++) {
+    for (uint8_t state = 0; state < 4; state++) {
+      for (uint8_t lsBit = 0; lsBit < 8; lsBit += 2) {
+        uint8_t chain = (reg & ~(0b11 << lsBit)) | (state << lsBit);
+        CHECK_EQ(PCA9532::packLsState(reg, state, lsBit), chain);
+      }
+    }
+  }
+  for (uint8_t state = 0; state < 4; state++) {
+    uint8_t reg = 0;
+    for (uint8_t lsBit = 0; lsBit < 8; lsBit += 2) {
+      reg = PCA9532::packLsState(reg, state, lsBit);
+    }
+    CHECK_EQ(PCA9532::packLsStateAll(state), reg);
+  }
+
+  // a slow fade of two groups with a little jitter
+  for (uint8_t f = 0; f < 4; f++) {
+    for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+      show[f][o] = (o < 8 ? 60 + 5 * f : 180 - 4 * f) + (f * 7 + o * 13) % 9;
+    }
+  }
+
+  HostBus::reset();
+  static PCA9532Fleet fleet(&Wire);
+  fleet.begin();
+  fleet.addDevice(0x62);
+
+  printf("CPU microbenchmarks, per call\n");
+
+  volatile uint8_t seed = 0x5A;
+  uint8_t reg = seed;
+
+  hostBench("packLsState", [&](uint32_t i) {
+    reg = PCA9532::packLsState(reg, i & 0b11, (i >> 1) & 0b110);
+    hostKeep(reg);
+  });
+  hostBench("packLsStateAll", [&](uint32_t i) {
+    reg ^= PCA9532::packLsStateAll(i);
+    hostKeep(reg);
+  });
+  hostBench("Fleet::setLsState (image only)", [&](uint32_t i) {
+    fleet.setLsState(0, i & 0b11, REG_LS0 + ((i >> 2) & 3), (i >> 3) & 0b110);
+  });
+  hostBench("Panel::outputBrightness", [&](uint32_t i) {
+    uint8_t level = PCA9532Panel::outputBrightness(image, i & 0x0F);
+    hostKeep(level);
+  });
+  hostBench("Budget::bytes", [&](uint32_t i) {
+    uint8_t bytes = PCA9532Budget::bytes((i * 0x2D) & 0x3FC);
+    hostKeep(bytes);
+  });
+  hostBench("Lookahead::plan (4 frames, window 1)", [&](uint32_t) {
+    uint32_t bytes = PCA9532Lookahead::plan(show, 4, 1, 8, planned);
+    hostKeep(bytes);
+  });
+  HostStats window2 = hostBench("Lookahead::plan (4 frames, window 2)", [&](uint32_t) {
+    uint32_t bytes = PCA9532Lookahead::plan(show, 4, 2, 8, planned);
+    hostKeep(bytes);
+  });
+  CHECK(window2.median > 0);
+
+  // no benchmark touched the bus
+  CHECK_EQ(HostBus::transactions(), 0);
+
+  return hostResult("bench_micro");
+}
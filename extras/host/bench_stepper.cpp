@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Stepper: highest step rate per bus clock, as reported by maxStepRate()
+ * and as reached on the simulated bus with a speed limit far above it,
+ * against stepping with one setLsState() per coil
+ */
+
+#include "HostTest.h"
+#include "PCA9532Stepper.h"
+
+#define ADDRESS 0x62
+#define STEPS   2000
+
+static const uint32_t CLOCKS[] = { 100000, 400000, 1000000 };
+
+int main() {
+
+  printf("stepper, %u full steps per clock\n", STEPS);
+  printf("  clock     maxStepRate  simulated  setLsState per coil\n");
+
+  for (uint8_t c = 0; c < sizeof(CLOCKS) / sizeof(CLOCKS[0]); c++) {
+
+    HostBus::reset();
+    HostBus::setTiming(HostBus::timingForClock(CLOCKS[c]));
+
+    PCA9532 pca9532(REG_PWM0, REG_PWM1);
+    pca9532.begin(ADDRESS, &Wire);
+    pca9532.setBusProfile(PCA9532::busProfileForClock(CLOCKS[c]));
+
+    PCA9532Stepper stepper(&pca9532, REG_LS0, STEP_MODE_FULL);
+    uint32_t reported = stepper.maxStepRate();
+
+    // the bus limits the speed, not the profile
+    stepper.setMaxSpeed(reported * 10.0);
+    stepper.setAcceleration(1e9);
+    stepper.move(STEPS);
+
+    pca9532.resetBusStats();
+    uint64_t start = HostBus::nanos();
+    uint32_t deadline;
+    while ((deadline = stepper.nextDeadlineMicros()) != NO_DEADLINE) {
+      delayMicroseconds(deadline);
+      stepper.update();
+    }
+    double simulated = STEPS * 1e9 / (HostBus::nanos() - start);
+
+    CHECK_EQ(stepper.getPosition(), STEPS);
+    CHECK_EQ(pca9532.getBusTransactions(), STEPS);
+    CHECK_EQ(pca9532.getBusBytes(), STEPS * 3);
+
+    // the same steps, coil by coil
+    static const uint8_t coils[] = { BIT_LS_LED0, BIT_LS_LED1, BIT_LS_LED2, BIT_LS_LED3 };
+    start = HostBus::nanos();
+    for (uint16_t s = 0; s < STEPS; s++) {
+      for (uint8_t i = 0; i < 4; i++) {
+        bool on = i == (s & 3) || i == ((s + 1) & 3);
+        pca9532.setLsState(on ? LS_STATE_ON : LS_STATE_OFF, REG_LS0, coils[i]);
+      }
+    }
+    double perCoil = STEPS * 1e9 / (HostBus::nanos() - start);
+
+    printf("  %7lu   %8lu/s  %7.0f/s  %10.0f/s\n", (unsigned long) CLOCKS[c],
+           (unsigned long) reported, simulated, perCoil);
+
+    // the estimate rounds the bus time of a step up to whole microseconds
+    CHECK(simulated >= reported * 0.98);
+    CHECK(simulated <= reported * 1.1);
+    CHECK(perCoil * 3 < simulated);
+  }
+
+  // settings that would give an infinite or undefined step interval are
+  // ignored, extreme ones are clamped to what the step timer can hold
+  HostBus::reset();
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+  PCA9532Stepper stepper(&pca9532, REG_LS0);
+  stepper.setMaxSpeed(0);
+  stepper.setMaxSpeed(-5);
+  stepper.setAcceleration(0);
+  stepper.setAcceleration(-1);
+  stepper.setAcceleration(NAN);
+  stepper.move(10);
+  uint32_t deadline = stepper.nextDeadlineMicros();
+  CHECK(deadline != NO_DEADLINE);
+  while ((deadline = stepper.nextDeadlineMicros()) != NO_DEADLINE) {
+    delayMicroseconds(deadline);
+    stepper.update();
+  }
+  CHECK_EQ(stepper.getPosition(), 10);
+
+  stepper.setMaxSpeed(1e-6);
+  stepper.setAcceleration(1e-9);
+  stepper.move(1);
+  CHECK(stepper.nextDeadlineMicros() <= 4000000000UL);
+  stepper.setMaxSpeed(1e9);
+  stepper.setAcceleration(1e20);
+  stepper.move(-1);
+  CHECK(stepper.nextDeadlineMicros() != NO_DEADLINE);
+
+  return hostResult("bench_stepper");
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Bus worker on std::thread: producer-side latency of enqueuing a command
+ * (waiting included while the queue is full) and end-to-end throughput until the last command reached its device.
+ * The simulated bus costs CPU time only, the throughput is an upper bound
+ * of the queue and coalescing, not of a real bus
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "HostTest.h"
+#include "PCA9532Worker.h"
+
+#define PRODUCERS 4
+#define COMMANDS  50000
+
+typedef std::chrono::steady_clock Clock;
+
+int main() {
+
+  HostBus::reset();
+  HostBus::setTiming(HostBus::timingForClock(1000000));
+
+  static PCA9532 *devices[PRODUCERS];
+  static PCA9532Worker worker;
+
+  for (uint8_t p = 0; p < PRODUCERS; p++) {
+    devices[p] = new PCA9532(REG_PWM0, REG_PWM1);
+    devices[p]->begin(0x60 + p, &Wire);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> processed(0);
+  uint16_t largestBatch = 0;
+
+  std::thread consumer([&]() {
+    for (;;) {
+      bool last = done.load();
+      uint16_t batch = worker.process();
+      processed += batch;
+      largestBatch = std::max(largestBatch, batch);
+      if (batch == 0) {
+        if (last) {
+          break;
+        }
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::vector<double> latencies[PRODUCERS];
+  uint32_t rejected[PRODUCERS] = { 0 };
+  std::thread producers[PRODUCERS];
+  Clock::time_point start = Clock::now();
+
+  for (uint8_t p = 0; p < PRODUCERS; p++) {
+    producers[p] = std::thread([&, p]() {
+      latencies[p].reserve(COMMANDS);
+      for (uint32_t i = 0; i < COMMANDS; i++) {
+        Clock::time_point before = Clock::now();
+        while (!worker.setPwm(devices[p], i & 1 ? REG_PWM1 : REG_PWM0, i >> 1)) {
+          // queue full, the producer decides how to wait
+          rejected[p]++;
+          std::this_thread::yield();
+        }
+        latencies[p].push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+      }
+    });
+  }
+
+  for (uint8_t p = 0; p < PRODUCERS; p++) {
+    producers[p].join();
+  }
+  done.store(true);
+  consumer.join();
+
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<double> all;
+  uint32_t rejects = 0;
+  for (uint8_t p = 0; p < PRODUCERS; p++) {
+    all.insert(all.end(), latencies[p].begin(), latencies[p].end());
+    rejects += rejected[p];
+  }
+  HostStats stats = hostStats(all);
+  double p99 = all[all.size() * 99 / 100];
+
+  printf("worker, %d producer threads, %d commands each, %u cores\n", PRODUCERS, COMMANDS,
+         std::thread::hardware_concurrency());
+  printf("  enqueue latency  median %.0f ns (MAD %.0f), p99 %.0f ns, max %.0f ns\n",
+         stats.median, stats.mad, p99, all.back());
+  printf("  queue full       %u times for %zu commands\n", rejects, all.size());
+  printf("  throughput       %.2f M commands/s, %u bus bytes, largest batch %u\n",
+         processed.load() / seconds / 1e6, HostBus::bytes(), largestBatch);
+
+  CHECK_EQ(processed.load(), (uint32_t) PRODUCERS * COMMANDS);
+  CHECK(largestBatch <= PCA9532_WORKER_QUEUE_SIZE);
+
+  // the last command of every producer reached its device
+  for (uint8_t p = 0; p < PRODUCERS; p++) {
+    CHECK_EQ(HostBus::regs(0x60 + p)[REG_PWM1], (uint8_t) ((COMMANDS - 1) >> 1));
+    CHECK_EQ(HostBus::regs(0x60 + p)[REG_PWM0], (uint8_t) ((COMMANDS - 2) >> 1));
+  }
+
+  return hostResult("bench_worker");
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Build the library against the Arduino stubs of this directory and run
+# every test_*.cpp and bench_*.cpp found here
+#
+#   ./run_tests.sh           all tests and benchmarks
+#   ./run_tests.sh test_lanes  only the named ones
+#
+
+set -e
+
+cd "$(dirname "$0")"
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=gnu++11 -O2 -Wall -Wextra -pthread"}
+# the simulated bus has a device at every address, fleets up to 64 devices
+CXXFLAGS="$CXXFLAGS -DPCA9532_FLEET_MAX_DEVICES=64"
+BUILD=build
+
+mkdir -p $BUILD
+
+for source in ../../src/*.cpp HostBus.cpp VirtualPanel.cpp; do
+  [ -f "$source" ] || continue
+  object=$BUILD/$(basename "$source" .cpp).o
+  $CXX $CXXFLAGS -I. -I../../src -c "$source" -o "$object"
+done
+
+if [ $# -gt 0 ]; then
+  programs="$*"
+else
+  programs=$(ls test_*.cpp bench_*.cpp 2>/dev/null | sed 's/\.cpp$//')
+fi
+
+failed=0
+
+for program in $programs; do
+  $CXX $CXXFLAGS -I. -I../../src "$program.cpp" $BUILD/*.o -o "$BUILD/$program"
+  if ! "$BUILD/$program"; then
+    failed=1
+  fi
+done
+
+exit $failed
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * PWM-cycle-aligned writes on a device whose oscillator runs 0.2% fast:
+ * glitches (PWM writes that cut a blink period in two) without alignment, with the
+ * nominal model, and with a calibration over one and over many periods.
+ * The nominal model is exact on an exact oscillator
+ */
+
+#include "HostTest.h"
+#include "PCA9532Aligner.h"
+
+#define ADDRESS 0x62
+#define PSC     4          // 32.9ms blink period
+#define UPDATES 200
+
+#define ORIGIN_NANOS 1234567ULL
+#define ERROR_PPM    2000
+
+enum Mode { UNALIGNED, NOMINAL, CAL_ONE, CAL_MANY };
+
+// PWM0 writes that cut a period of the device in two
+static uint16_t glitches(Mode mode, int32_t errorPpm = ERROR_PPM) {
+
+  HostBus::reset();
+  HostBus::setOscillator(ADDRESS, errorPpm, ORIGIN_NANOS);
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+  pca9532.setBlinking(REG_PSC0, PSC);
+  pca9532.setPwm(REG_PWM0, 128);
+  pca9532.setLsState(LS_STATE_BLNK0, REG_LS0, BIT_LS_LED0);
+
+  uint32_t period = PCA9532Panel::blinkPeriodMicros(PSC);
+
+  PCA9532Aligner aligner(&pca9532);
+  aligner.setMaxWait(period);
+  if (mode == NOMINAL) {
+    aligner.setTimebase(ORIGIN_NANOS / 1000);
+  } else if (mode == CAL_ONE) {
+    CHECK(aligner.calibrate(0, 3 * period, 1));
+  } else if (mode == CAL_MANY) {
+    CHECK(aligner.calibrate(0, (ALIGN_CAL_PERIODS + 2) * period));
+    // the other channel has an origin of its own, still unknown
+    CHECK_EQ(aligner.untilBoundaryMicros(REG_PSC1), 0);
+  }
+
+  HostBus::clearLog();
+  uint32_t random = 1;
+
+  for (uint16_t u = 0; u < UPDATES; u++) {
+    random = random * 1103515245 + 12345;
+    HostBus::advance(((random >> 16) % 20000 + 5000) * 1000ULL);
+    pca9532.queueReg(REG_PWM0, u & 1 ? 32 : 224);
+    if (mode == UNALIGNED) {
+      pca9532.flush();
+    } else {
+      CHECK(aligner.flushAligned(REG_PSC0, period));
+    }
+  }
+
+  uint16_t count = 0;
+  uint8_t pwm = 128;
+  const std::vector<HostWrite> &log = HostBus::log();
+  for (size_t i = 0; i < log.size(); i++) {
+    if (log[i].address != ADDRESS || log[i].reg != REG_PWM0) {
+      continue;
+    }
+    // the period is cut in two if its on time ends up at neither the old
+    // nor the new duty cycle
+    uint32_t phase = HostBus::deviceMicros(ADDRESS, log[i].nanos) % period;
+    uint32_t oldOn = (uint64_t) period * pwm / 256;
+    uint32_t newOn = (uint64_t) period * log[i].value / 256;
+    if (phase > std::min(oldOn, newOn) && phase < std::max(oldOn, newOn)) {
+      count++;
+    }
+    pwm = log[i].value;
+  }
+
+  return count;
+}
+
+int main() {
+
+  uint16_t unaligned = glitches(UNALIGNED);
+  uint16_t nominal = glitches(NOMINAL);
+  uint16_t calOne = glitches(CAL_ONE);
+  uint16_t calMany = glitches(CAL_MANY);
+  uint16_t exact = glitches(NOMINAL, 0);
+
+  printf("aligned writes, %u PWM updates over about 3s, oscillator +%u ppm\n", UPDATES, ERROR_PPM);
+  printf("  unaligned                  %3u glitches\n", unaligned);
+  printf("  nominal model              %3u glitches\n", nominal);
+  printf("  calibrated over 1 period   %3u glitches\n", calOne);
+  printf("  calibrated over %2u periods %3u glitches\n", ALIGN_CAL_PERIODS, calMany);
+  printf("  nominal model, exact       %3u glitches\n", exact);
+
+  CHECK(unaligned > UPDATES / 2);
+  CHECK(nominal < unaligned);
+  CHECK(calOne < unaligned);
+  // the period error left is about one input read over the periods measured
+  CHECK(calMany * 4 < calOne);
+  CHECK_EQ(exact, 0);
+
+  return hostResult("test_aligner");
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Compile-time bus budget: long scenes are checked by static_assert, the
+ * result matches the bytes the driver puts on the simulated bus
+ */
+
+#include "HostTest.h"
+#include "PCA9532Budget.h"
+
+#define ADDRESS 0x62
+
+// PWM0, PWM1 and LS0 change every frame: 2 bursts, 7 bytes
+#define FRAME(n)      { 0, 0, 0, (uint8_t) ((n) * 7 + 1), 0, (uint8_t) ((n) * 3 + 1), \
+                        (uint8_t) ((n) & 1 ? 0x55 : 0xAA), 0, 0, 0 },
+#define FRAMES10(n)   FRAME(n) FRAME(n + 1) FRAME(n + 2) FRAME(n + 3) FRAME(n + 4) \
+                      FRAME(n + 5) FRAME(n + 6) FRAME(n + 7) FRAME(n + 8) FRAME(n + 9)
+#define FRAMES100(n)  FRAMES10(n) FRAMES10(n + 10) FRAMES10(n + 20) FRAMES10(n + 30) \
+                      FRAMES10(n + 40) FRAMES10(n + 50) FRAMES10(n + 60) FRAMES10(n + 70) \
+                      FRAMES10(n + 80) FRAMES10(n + 90)
+#define FRAMES1000(n) FRAMES100(n) FRAMES100(n + 100) FRAMES100(n + 200) FRAMES100(n + 300) \
+                      FRAMES100(n + 400) FRAMES100(n + 500) FRAMES100(n + 600) \
+                      FRAMES100(n + 700) FRAMES100(n + 800) FRAMES100(n + 900)
+
+static constexpr uint8_t scene[][REG_COUNT] = { FRAMES1000(0) };
+static constexpr uint16_t SCENE_FRAMES = sizeof(scene) / sizeof(scene[0]);
+
+// the same frame over and over, only frame 0 costs anything
+#define STILL(n)      { 0, 0, 0, 0x80, 0, 0x80, 0x55, 0, 0, 0 },
+#define STILL10(n)    STILL(n) STILL(n) STILL(n) STILL(n) STILL(n) \
+                      STILL(n) STILL(n) STILL(n) STILL(n) STILL(n)
+#define STILL100(n)   STILL10(n) STILL10(n) STILL10(n) STILL10(n) STILL10(n) \
+                      STILL10(n) STILL10(n) STILL10(n) STILL10(n) STILL10(n)
+
+static constexpr uint8_t still[][REG_COUNT] = { STILL100(0) STILL100(0) STILL100(0) };
+
+// frame 0 sends PSC0 to LS3: 1 transaction of 10 bytes, 925us at 100kHz
+static_assert(SCENE_FRAMES == 1000, "scene length");
+static_assert(PCA9532Budget::maxFrameMicros(scene, SCENE_FRAMES, 100000) == 925, "scene frame 0");
+// a scene starting at frame 1 sends its own first frame in full
+static_assert(PCA9532Budget::maxFrameMicros(scene + 1, SCENE_FRAMES - 1, 100000) == 925, "scene from frame 1");
+static_assert(PCA9532Budget::maxFrameMicros(still, 300, 100000) == 925, "still scene");
+static_assert(PCA9532Budget::maxRangeMicros(scene, 1, SCENE_FRAMES, PCA9532Budget::profileForClock(100000))
+              == 680, "scene frames after the first");
+PCA9532_ASSERT_BUDGET(scene, 100000, 60);
+PCA9532_ASSERT_BUDGET(still, 400000, 200);
+static_assert(!PCA9532Budget::fits(scene, SCENE_FRAMES, 100000, 2000), "scene over budget");
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  // play the scene, the most expensive frame after the first must match
+  uint64_t worst = 0;
+  for (uint16_t frame = 0; frame < SCENE_FRAMES; frame++) {
+    for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg++) {
+      if (frame == 0 || scene[frame][reg] != scene[frame - 1][reg]) {
+        pca9532.queueReg(reg, scene[frame][reg]);
+      }
+    }
+    uint64_t start = HostBus::nanos();
+    pca9532.flush();
+    if (frame > 0) {
+      worst = std::max(worst, HostBus::nanos() - start);
+    }
+  }
+
+  uint32_t budget = PCA9532Budget::maxRangeMicros(scene, 1, SCENE_FRAMES,
+                                                  PCA9532Budget::profileForClock(100000));
+  printf("bus budget of a %u frame scene at 100kHz\n", SCENE_FRAMES);
+  printf("  compile time %u us, simulated %llu us\n", budget, (unsigned long long) (worst + 999) / 1000);
+  CHECK_EQ((worst + 999) / 1000, budget);
+
+  return hostResult("test_budget");
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Bus profile: extras/calibrate_bus.py recovers the timing of the
+ * simulated bus from a capture, the estimates of the driver, the budget
+ * and the lookahead planner follow the profile including the idle time.
+ * Dry runs count the transactions and bytes flush() really sends
+ */
+
+#include "HostTest.h"
+#include "PCA9532Budget.h"
+#include "PCA9532Lookahead.h"
+
+#define ADDRESS 0x62
+
+static const HostTiming MEASURED = { 2600, 23100, 2700, 9800 };
+
+// workload with bursts of all lengths, single writes and reads
+static void workload(PCA9532 &pca9532) {
+
+  for (uint8_t length = 1; length <= 8; length++) {
+    for (uint8_t r = 0; r < length; r++) {
+      pca9532.queueReg(REG_PSC0 + r, length * 16 + r);
+    }
+    pca9532.flush();
+    pca9532.setPwm(REG_PWM0, length);
+    pca9532.readInputs(0);
+  }
+}
+
+int main() {
+
+  HostBus::reset();
+  HostBus::setTiming(MEASURED);
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  // other traffic on the bus counts for the idle time only
+  PCA9532 other(REG_PWM0, REG_PWM1);
+  other.begin(ADDRESS + 1, &Wire);
+
+  FILE *capture = fopen("build/capture.csv", "w");
+  CHECK(capture != NULL);
+  fprintf(capture, "name,type,start_time,duration,ack,address,read,data\n");
+  HostBus::setCapture(capture);
+  for (uint8_t i = 0; i < 10; i++) {
+    workload(pca9532);
+    other.setPwm(REG_PWM1, i);
+    delay(5); // application pause, not part of the idle time
+  }
+  HostBus::setCapture(NULL);
+  fclose(capture);
+
+  FILE *fit = popen("python3 ../calibrate_bus.py --address 0x62 build/capture.csv", "r");
+  char line[200];
+  PCA9532BusProfile fitted = { 0, 0, 0, 0 };
+  bool found = false;
+  while (fit && fgets(line, sizeof(line), fit)) {
+    printf("  %s", line);
+    found |= sscanf(line, "const PCA9532BusProfile busProfile = { %u, %u, %u, %u };",
+                    &fitted.startNanos, &fitted.byteNanos, &fitted.stopNanos, &fitted.idleNanos) == 4;
+  }
+  CHECK(fit && pclose(fit) == 0);
+  CHECK(found);
+  CHECK_EQ(fitted.startNanos, MEASURED.startNanos);
+  CHECK_EQ(fitted.byteNanos, MEASURED.byteNanos);
+  CHECK_EQ(fitted.stopNanos, MEASURED.stopNanos);
+  CHECK_EQ(fitted.idleNanos, MEASURED.idleNanos);
+
+  // the fitted profile predicts the bus time of a flush
+  pca9532.setBusProfile(fitted);
+  for (uint8_t r = REG_PSC0; r < REG_COUNT; r += 3) {
+    pca9532.queueReg(r, 0x5A);
+  }
+  PCA9532BusCost cost = pca9532.estimateFlush();
+  uint64_t start = HostBus::nanos();
+  pca9532.flush();
+  uint32_t measured = (HostBus::nanos() - start + 999) / 1000;
+  printf("  flush of %u transactions: estimated %lu us, measured %lu us\n", cost.transactions,
+         (unsigned long) cost.micros, (unsigned long) measured);
+  CHECK_EQ(cost.micros, measured);
+
+  // dry runs of writing registers or a register image match the bus
+  // traffic of the flush() that does it
+  pca9532.flush();
+  PCA9532BusCost none = pca9532.estimateFlush();
+  CHECK_EQ(none.transactions, 0);
+  CHECK_EQ(none.bytes, 0);
+
+  uint16_t gaps = 1 << REG_PWM0 | 1 << REG_LS3;
+  PCA9532BusCost registers = pca9532.estimateRegisters(gaps);
+  pca9532.resetBusStats();
+  pca9532.queueReg(REG_PWM0, 0x12);
+  pca9532.queueReg(REG_LS3, 0x34);
+  pca9532.flush();
+  printf("  PWM0 and LS3: estimated %u transactions %u bytes, sent %lu %lu\n",
+         registers.transactions, registers.bytes, (unsigned long) pca9532.getBusTransactions(),
+         (unsigned long) pca9532.getBusBytes());
+  CHECK_EQ(registers.transactions, 2);
+  CHECK_EQ(registers.transactions, pca9532.getBusTransactions());
+  CHECK_EQ(registers.bytes, pca9532.getBusBytes());
+
+  uint8_t target[REG_COUNT];
+  for (uint8_t r = 0; r < REG_COUNT; r++) {
+    target[r] = pca9532.getRegImage(r);
+  }
+  PCA9532BusCost same = pca9532.estimateImage(target);
+  CHECK_EQ(same.transactions, 0);
+  CHECK_EQ(same.bytes, 0);
+  CHECK_EQ(same.micros, 0);
+
+  target[REG_PSC0]++;
+  target[REG_PWM0]++;
+  target[REG_PSC1]++;
+  target[REG_LS2]++;
+  PCA9532BusCost image = pca9532.estimateImage(target);
+  pca9532.resetBusStats();
+  for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+    if (target[r] != pca9532.getRegImage(r)) {
+      pca9532.queueReg(r, target[r]);
+    }
+  }
+  pca9532.flush();
+  CHECK_EQ(image.transactions, 2);
+  CHECK_EQ(image.transactions, pca9532.getBusTransactions());
+  CHECK_EQ(image.bytes, pca9532.getBusBytes());
+
+  // budget uses the same model, with a profile or a bus clock
+  static const uint32_t CLOCKS[] = { 100000, 400000, 1000000 };
+  for (uint8_t c = 0; c < 3; c++) {
+    PCA9532BusProfile a = PCA9532::busProfileForClock(CLOCKS[c]);
+    PCA9532BusProfile b = PCA9532Budget::profileForClock(CLOCKS[c]);
+    CHECK(memcmp(&a, &b, sizeof(a)) == 0);
+    CHECK_EQ(PCA9532Budget::micros(0x3C0, CLOCKS[c]), PCA9532::estimateBusMicros(a, 1, 6));
+  }
+  CHECK_EQ(PCA9532Budget::micros(0x3C0, fitted), PCA9532::estimateBusMicros(fitted, 1, 6));
+
+  // lookahead: expensive transactions favour longer bursts
+  static uint8_t levels[64][LOOKAHEAD_OUTPUTS];
+  for (uint8_t f = 0; f < 64; f++) {
+    for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+      levels[f][o] = (f * 7 + o * 29) % 256;
+    }
+  }
+  PCA9532BusProfile slowStart = { 200000, 1000, 200000, 200000 };
+  PCA9532BusProfile slowByte = { 1000, 200000, 1000, 1000 };
+  static uint8_t images[2][64][REG_COUNT];
+  PCA9532Lookahead::plan(levels, 64, 4, 24, images[0], NULL, &slowStart);
+  PCA9532Lookahead::plan(levels, 64, 4, 24, images[1], NULL, &slowByte);
+
+  uint32_t transactions[2] = { 0, 0 }, bytes[2] = { 0, 0 };
+  for (uint8_t p = 0; p < 2; p++) {
+    for (uint8_t f = 1; f < 64; f++) {
+      uint16_t mask = 0;
+      for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+        mask |= images[p][f][r] != images[p][f - 1][r] ? 1 << r : 0;
+      }
+      transactions[p] += PCA9532Budget::transactions(mask);
+      bytes[p] += PCA9532Budget::bytes(mask);
+    }
+  }
+  printf("  lookahead, slow START/STOP: %u transactions, %u bytes\n", transactions[0], bytes[0]);
+  printf("  lookahead, slow bytes:      %u transactions, %u bytes\n", transactions[1], bytes[1]);
+  CHECK(transactions[0] <= transactions[1]);
+  CHECK(bytes[1] <= bytes[0]);
+
+  return hostResult("test_bus_profile");
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Hardware crossfade: LS states at the start, PWM ramp per step and the
+ * settled on/off states at the end, 10 + 5 * (steps - 1) + 6 bus bytes
+ * whatever the number of LEDs, and a crossfade without duration
+ */
+
+#include "HostTest.h"
+#include "PCA9532Crossfade.h"
+
+#define ADDRESS 0x62
+#define FROM    0x00FF // LED0 to LED7
+#define TO      0x0FF0 // LED4 to LED11
+
+// LS state of an output on the device
+static uint8_t state(uint8_t output) {
+
+  return (HostBus::regs(ADDRESS)[REG_LS0 + output / 4] >> (2 * (output % 4))) & 0b11;
+}
+
+// every output in the expected state for its scenes
+static void checkStates(uint8_t onlyFrom, uint8_t onlyTo, uint8_t both, uint8_t neither) {
+
+  for (uint8_t o = 0; o < 16; o++) {
+    bool from = FROM & (1 << o);
+    bool to = TO & (1 << o);
+    CHECK_EQ(state(o), from && to ? both : from ? onlyFrom : to ? onlyTo : neither);
+  }
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  PCA9532Crossfade crossfade(&pca9532);
+
+  printf("crossfade, %u steps\n", CROSSFADE_STEPS);
+
+  pca9532.resetBusStats();
+  crossfade.start(FROM, TO, 800);
+  CHECK(crossfade.isRunning());
+  CHECK_EQ(pca9532.getBusBytes(), 10);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM0], 255);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM1], 0);
+  checkStates(LS_STATE_BLNK0, LS_STATE_BLNK1, LS_STATE_ON, LS_STATE_OFF);
+
+  uint8_t steps = 0;
+  uint32_t deadline;
+  while ((deadline = crossfade.nextDeadlineMicros()) != NO_DEADLINE) {
+    delayMicroseconds(deadline);
+    bool running = crossfade.update();
+    if (running) {
+      // PWM1 ramps up, PWM0 down, the LS states stay
+      steps++;
+      uint8_t pwm1 = (uint16_t) 255 * steps / CROSSFADE_STEPS;
+      CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM1], pwm1);
+      CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM0], 255 - pwm1);
+      checkStates(LS_STATE_BLNK0, LS_STATE_BLNK1, LS_STATE_ON, LS_STATE_OFF);
+    }
+  }
+
+  printf("  %u intermediate steps, %u bus bytes\n", steps, pca9532.getBusBytes());
+  CHECK_EQ(steps, CROSSFADE_STEPS - 1);
+  CHECK_EQ(pca9532.getBusBytes(), 10 + 5 * (CROSSFADE_STEPS - 1) + 6);
+  CHECK_EQ(pca9532.getBusBytes(), 51);
+  CHECK(!crossfade.isRunning());
+  checkStates(LS_STATE_OFF, LS_STATE_ON, LS_STATE_ON, LS_STATE_OFF);
+
+  // no duration: start and settle at the first update
+  pca9532.resetBusStats();
+  crossfade.start(TO, FROM, 0);
+  CHECK_EQ(crossfade.nextDeadlineMicros(), 0);
+  CHECK(!crossfade.update());
+  CHECK(!crossfade.isRunning());
+  CHECK_EQ(crossfade.nextDeadlineMicros(), NO_DEADLINE);
+  CHECK_EQ(pca9532.getBusBytes(), 10 + 6);
+  for (uint8_t o = 0; o < 16; o++) {
+    CHECK_EQ(state(o), FROM & (1 << o) ? LS_STATE_ON : LS_STATE_OFF);
+  }
+
+  return hostResult("test_crossfade");
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Deterministic-timing mode: every public call stays within its
+ * documented bus byte and transaction bound, for all arguments, every
+ * combination of pending registers (clean, bulk or high per register)
+ * and with a faulty bus
+ */
+
+#include "HostTest.h"
+
+#define ADDRESS 0x60
+
+struct Bound {
+    const char *name;
+    uint16_t args;
+    uint8_t bytes;
+    uint8_t transactions;
+};
+
+// table of PCA9532.h, see setDeterministic()
+static const Bound BOUNDS[] = {
+    { "turnOn",             1,  6, 1 },
+    { "turnOff",            1,  6, 1 },
+    { "setLsStateAll",      4,  6, 1 },
+    { "setGrpPwm",          256, 5, 1 },
+    { "setPwm",             512, 3, 1 },
+    { "setBlinking",        512, 3, 1 },
+    { "setLsState",         64, 3, 1 },
+    { "flushStep",          1, 10, 1 },
+    { "flush",              1, 10, 1 },
+    { "resync",             1, 10, 1 },
+    { "readInputs",         2,  5, 2 },
+    { "flushAndReadInputs", 1, 15, 3 },
+};
+
+#define CALLS (sizeof(BOUNDS) / sizeof(BOUNDS[0]))
+
+static void call(PCA9532 &pca9532, uint8_t c, uint16_t arg) {
+
+  switch (c) {
+    case 0: pca9532.turnOn(); break;
+    case 1: pca9532.turnOff(); break;
+    case 2: pca9532.setLsStateAll(arg); break;
+    case 3: pca9532.setGrpPwm(arg); break;
+    case 4: pca9532.setPwm(arg & 0x100 ? REG_PWM1 : REG_PWM0, arg); break;
+    case 5: pca9532.setBlinking(arg & 0x100 ? REG_PSC1 : REG_PSC0, arg); break;
+    case 6: pca9532.setLsState(arg & 3, REG_LS0 + (arg >> 4), ((arg >> 2) & 3) << 1); break;
+    case 7: pca9532.flushStep(); break;
+    case 8: pca9532.flush(); break;
+    case 9: pca9532.resync(); break;
+    case 10: pca9532.readInputs(arg ? 1000000 : 0); break;
+    case 11: pca9532.flushAndReadInputs(); break;
+  }
+}
+
+// worst bytes and transactions seen per call, on the bus and as counted
+// by the driver
+static void checkBounds(const PCA9532 &base, const char *title) {
+
+  printf("%s\n", title);
+
+  for (uint8_t c = 0; c < CALLS; c++) {
+
+    uint32_t worstBytes = 0, worstTransactions = 0, worstCounted = 0;
+
+    // pending state of the 8 writable registers: 0 clean, 1 bulk, 2 high
+    for (uint16_t pending = 0; pending < 6561; pending++) {
+
+      PCA9532 pca9532 = base;
+      uint16_t state = pending;
+      for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg++, state /= 3) {
+        if (state % 3) {
+          pca9532.queueReg(reg, pending + reg, state % 3 == 2 ? PRIORITY_HIGH : PRIORITY_BULK);
+        }
+      }
+
+      // arguments exhaustively for one pending state in 16
+      uint16_t args = pending % 16 ? 1 : BOUNDS[c].args;
+
+      for (uint16_t arg = 0; arg < args; arg++) {
+
+        PCA9532 device = pca9532;
+        uint32_t bytes = HostBus::bytes();
+        uint32_t transactions = HostBus::transactions();
+        uint32_t counted = device.getBusBytes();
+
+        call(device, c, args > 1 ? arg : pending % BOUNDS[c].args);
+
+        worstBytes = std::max(worstBytes, HostBus::bytes() - bytes);
+        worstTransactions = std::max(worstTransactions, HostBus::transactions() - transactions);
+        worstCounted = std::max(worstCounted, device.getBusBytes() - counted);
+      }
+    }
+
+    printf("  %-20s %2u bytes, %u transactions (bound %2u, %u)\n", BOUNDS[c].name,
+           worstBytes, worstTransactions, BOUNDS[c].bytes, BOUNDS[c].transactions);
+    CHECK(worstBytes <= BOUNDS[c].bytes);
+    CHECK(worstCounted <= BOUNDS[c].bytes);
+    CHECK(worstTransactions <= BOUNDS[c].transactions);
+    CHECK(BOUNDS[c].bytes <= DETERMINISTIC_MAX_BUS_BYTES);
+  }
+}
+
+int main() {
+
+  HostBus::reset();
+
+  // reflex that always fires, so flushAndReadInputs() has work to queue
+  static const PCA9532Reflex REFLEXES[] = { { 0, 0, 5, LS_STATE_BLNK1 } };
+
+  PCA9532 base(REG_PWM0, REG_PWM1);
+  base.begin(ADDRESS, &Wire);
+  base.setReflexes(REFLEXES, 1);
+  CHECK(base.setDeterministic(true));
+  base.resetBusStats();
+
+  checkBounds(base, "deterministic mode, healthy bus");
+
+  HostFaults faults = { 0.1, 0.05, 0.05, 0.02, 0.01, 100 };
+  HostBus::setFaults(faults);
+  checkBounds(base, "deterministic mode, faulty bus");
+  HostBus::setFaults(HostFaults());
+
+  // flushAndReadInputs() finishes the work over several calls, one burst
+  // each, the reflex output of the first call goes out with the second
+  PCA9532 pca9532 = base;
+  for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg += 2) {
+    pca9532.queueReg(reg, 0x11 * reg);
+  }
+  uint8_t calls = 0;
+  while (pca9532.isPending(PRIORITY_BULK) && calls < 10) {
+    pca9532.flushAndReadInputs();
+    calls++;
+  }
+  CHECK_EQ(calls, 5);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS2], 0x88);
+  CHECK(!pca9532.isPending(PRIORITY_HIGH));
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS1], LS_STATE_BLNK1 << BIT_LS_LED5);
+
+  // a failed direct write leaves nothing pending behind
+  HostFaults nack = { 1, 0, 0, 0, 0, 0 };
+  HostBus::setFaults(nack);
+  pca9532 = base;
+  pca9532.setPwm(REG_PWM0, 0x42);
+  CHECK(!pca9532.isPending(PRIORITY_BULK) && !pca9532.isPending(PRIORITY_HIGH));
+  CHECK_EQ(pca9532.getBusErrors(), 1);
+
+  // the mode stays off if the register image cannot be read
+  PCA9532 offline(REG_PWM0, REG_PWM1);
+  offline.begin(ADDRESS, &Wire);
+  CHECK(!offline.setDeterministic(true));
+  HostBus::setFaults(HostFaults());
+  offline.resetBusStats();
+  offline.setLsState(LS_STATE_ON, REG_LS0, BIT_LS_LED0);
+  CHECK_EQ(offline.getBusTransactions(), 3); // read before write
+  CHECK(offline.setDeterministic(true));
+
+  // registers queued before the mode is enabled keep their queued value
+  {
+    PCA9532 queued(REG_PWM0, REG_PWM1);
+    queued.begin(ADDRESS, &Wire);
+    queued.queueReg(REG_PWM0, 0x21);
+    queued.queueReg(REG_LS3, 0x43, PRIORITY_HIGH);
+    CHECK(HostBus::regs(ADDRESS)[REG_PWM0] != 0x21); // not sent yet
+    CHECK(queued.setDeterministic(true));
+    CHECK(queued.isPending(PRIORITY_BULK) && queued.isPending(PRIORITY_HIGH));
+    CHECK_EQ(queued.getRegImage(REG_PWM0), 0x21);
+    CHECK_EQ(queued.getRegImage(REG_LS3), 0x43);
+    while (queued.isPending(PRIORITY_BULK) || queued.isPending(PRIORITY_HIGH)) {
+      queued.flush();
+    }
+    CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM0], 0x21);
+    CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS3], 0x43);
+    // the registers not queued were read from the device
+    CHECK(HostBus::regs(ADDRESS)[REG_LS0] != 0);
+    CHECK_EQ(queued.getRegImage(REG_LS0), HostBus::regs(ADDRESS)[REG_LS0]);
+  }
+
+  return hostResult("test_deterministic");
+}
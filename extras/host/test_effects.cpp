@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Effect pool: a handle of a finished effect does not stop the effect
+ * that reuses its slot, a step may stop the effect after it or itself,
+ * and a fade leaves most of the bus to others
+ */
+
+#include "HostTest.h"
+#include "PCA9532Effects.h"
+
+#define ADDRESS 0x62
+
+// run the pool until no effect is left
+static void runAll(PCA9532EffectPool &pool) {
+
+  uint32_t deadline;
+  while ((deadline = pool.nextDeadlineMicros()) != NO_DEADLINE) {
+    delayMicroseconds(deadline);
+    pool.update();
+  }
+}
+
+static PCA9532EffectPool pool;
+static uint16_t stepsRun;
+
+// stops the effect whose handle is in the context, maybe itself, and asks
+// to go on
+static uint32_t stopHandle(PCA9532Effect &effect, uint32_t elapsedMicros) {
+
+  pool.stop(*(uint16_t *) effect.context);
+  stepsRun++;
+
+  return elapsedMicros + 1000;
+}
+
+// counts its steps, runs forever
+static uint32_t count(PCA9532Effect &, uint32_t elapsedMicros) {
+
+  stepsRun += 100;
+
+  return elapsedMicros + 1000;
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  printf("effect pool, %u slots\n", PCA9532_EFFECT_POOL_SIZE);
+
+  // a stale handle: the slot of the finished fade is taken by the next one
+  uint16_t finished = pool.fade(&pca9532, REG_PWM1, 0x10, 10);
+  runAll(pool);
+  uint16_t reused = pool.fade(&pca9532, REG_PWM1, 0x90, 100);
+  CHECK_EQ(finished & 0xFF, reused & 0xFF);
+  CHECK(finished != reused);
+  pool.stop(finished);
+  CHECK_EQ(pool.getUsed(), 1);
+  pool.stop(reused);
+  CHECK_EQ(pool.getUsed(), 0);
+  pool.stop(reused);
+  CHECK_EQ(pool.getUsed(), 0);
+
+  // an exhausted pool
+  uint16_t handles[PCA9532_EFFECT_POOL_SIZE];
+  for (uint8_t i = 0; i < PCA9532_EFFECT_POOL_SIZE; i++) {
+    handles[i] = pool.fade(&pca9532, REG_PWM1, i, 100);
+    CHECK(handles[i] != EFFECT_NONE);
+  }
+  CHECK_EQ(pool.fade(&pca9532, REG_PWM1, 0, 100), EFFECT_NONE);
+  for (uint8_t i = 0; i < PCA9532_EFFECT_POOL_SIZE; i++) {
+    pool.stop(handles[i]);
+  }
+  CHECK_EQ(pool.getUsed(), 0);
+
+  // a step stops the effect after it in the active list: the victim,
+  // started first, sits behind the stopper
+  static uint16_t victim, self;
+  victim = pool.start(&pca9532, count, NULL, 100);
+  uint16_t stopper = pool.start(&pca9532, stopHandle, &victim, 100);
+  self = pool.start(&pca9532, stopHandle, &self, 100);
+  CHECK_EQ(pool.getUsed(), 3);
+  stepsRun = 0;
+  pool.update();
+  CHECK_EQ(stepsRun, 2);
+  CHECK_EQ(pool.getUsed(), 1);
+  delayMicroseconds(2000);
+  pool.update();
+  CHECK_EQ(stepsRun, 3);
+  pool.stop(stopper);
+  CHECK_EQ(pool.getUsed(), 0);
+
+  // the free list survived: every slot can be taken again
+  for (uint8_t i = 0; i < PCA9532_EFFECT_POOL_SIZE; i++) {
+    handles[i] = pool.start(&pca9532, count, NULL, 100);
+    CHECK(handles[i] != EFFECT_NONE);
+  }
+  for (uint8_t i = 0; i < PCA9532_EFFECT_POOL_SIZE; i++) {
+    pool.stop(handles[i]);
+  }
+  CHECK_EQ(pool.getUsed(), 0);
+
+  // a full-range fade over 100ms writes at most every
+  // EFFECT_MIN_INTERVAL_MICROS and ends on the target value
+  pca9532.setPwm(REG_PWM0, 0);
+  pca9532.resetBusStats();
+  uint64_t start = HostBus::nanos();
+  pool.fade(&pca9532, REG_PWM0, 255, 100);
+  runAll(pool);
+  double busMicros = pca9532.estimateBusMicros(pca9532.getBusTransactions(), pca9532.getBusBytes());
+  double share = 100.0 * busMicros / ((HostBus::nanos() - start) / 1000.0);
+
+  printf("  fade 0 to 255 in 100ms: %u writes, %.1f%% of the bus\n",
+         pca9532.getBusTransactions(), share);
+  CHECK(pca9532.getBusTransactions() <= 100000 / EFFECT_MIN_INTERVAL_MICROS + 1);
+  CHECK(share < 5);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM0], 255);
+
+  return hostResult("test_effects");
+}
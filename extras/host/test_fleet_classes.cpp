@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Refresh classes: a device that does not fit the remaining byte budget
+ * is skipped, cheaper devices of its class behind it are still sent
+ */
+
+#include "HostTest.h"
+#include "PCA9532Fleet.h"
+
+#define ADDRESS 0x60
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532Fleet fleet(&Wire);
+  fleet.begin();
+  for (uint8_t d = 0; d < 5; d++) {
+    fleet.addDevice(ADDRESS + d);
+  }
+
+  // devices 0 to 3 animate in class 1, device 4 shows status in class 0
+  fleet.setRefreshClass(1, 0, 1);
+  for (uint8_t d = 0; d < 4; d++) {
+    fleet.setDeviceClass(d, 1);
+  }
+
+  // device 0 with all registers pending costs 10 bytes, the others 3
+  for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg++) {
+    fleet.setReg(0, reg, 0x11);
+  }
+  for (uint8_t d = 1; d < 5; d++) {
+    fleet.setPwm(d, REG_PWM0, 0x40 + d);
+  }
+
+  printf("refresh classes, device 0 of 10 bytes ahead of three of 3 bytes\n");
+
+  uint16_t sent = fleet.service(9);
+  printf("  budget  9: %2u bytes sent\n", sent);
+  CHECK_EQ(sent, 9);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS3], 0);
+  for (uint8_t d = 1; d < 4; d++) {
+    CHECK_EQ(HostBus::regs(ADDRESS + d)[REG_PWM0], 0x40 + d);
+  }
+  CHECK_EQ(HostBus::regs(ADDRESS + 4)[REG_PWM0], 0x80);
+
+  // the skipped device goes first once the budget fits it
+  sent = fleet.service(13);
+  printf("  budget 13: %2u bytes sent\n", sent);
+  CHECK_EQ(sent, 13);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS3], 0x11);
+  CHECK_EQ(HostBus::regs(ADDRESS + 4)[REG_PWM0], 0x44);
+  CHECK(!fleet.isPending());
+
+  return hostResult("test_fleet_classes");
+}
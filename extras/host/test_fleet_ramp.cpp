@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Master dimmer ramp: the pass interval follows the number of devices and
+ * the bus profile, so a ramp stays within FLEET_RAMP_BUS_SHARE of the bus.
+ * A pass is one chained transaction and leaves nothing pending behind
+ */
+
+#include "HostTest.h"
+#include "PCA9532Fleet.h"
+
+// share of the bus taken by a ramp over all devices, in percent
+static double rampShare(uint8_t devices, uint32_t clockHz) {
+
+  HostBus::reset();
+  HostBus::setTiming(HostBus::timingForClock(clockHz));
+
+  PCA9532Fleet *fleet = new PCA9532Fleet(&Wire);
+  fleet->begin();
+  fleet->setBusProfile(PCA9532::busProfileForClock(clockHz));
+  for (uint8_t d = 0; d < devices; d++) {
+    fleet->addDevice(d);
+    fleet->setPwm(d, REG_PWM0, 255);
+    fleet->setPwm(d, REG_PWM1, 200);
+  }
+  fleet->flush();
+  fleet->setMasterBrightness(0);
+
+  uint64_t start = HostBus::nanos();
+  uint64_t idle = 0;
+  uint16_t passes = 0;
+
+  fleet->rampMasterBrightness(255, 2000);
+  for (;;) {
+    uint32_t bytes = HostBus::bytes();
+    if (!fleet->update()) {
+      break;
+    }
+    passes += HostBus::bytes() != bytes;
+    // the application sleeps until the next pass is due
+    uint32_t wait = fleet->nextDeadlineMicros();
+    wait = wait ? wait : 1;
+    delayMicroseconds(wait);
+    idle += (uint64_t) wait * 1000;
+  }
+
+  double share = 100.0 * (HostBus::nanos() - start - idle) / (HostBus::nanos() - start);
+
+  printf("  %2u devices at %7lu Hz: interval %6lu us, %3u passes, %4.1f%% of the bus\n",
+         devices, (unsigned long) clockHz, (unsigned long) fleet->rampIntervalMicros(),
+         passes, share);
+
+  CHECK_EQ(fleet->getMasterBrightness(), 255);
+  delete fleet;
+
+  return share;
+}
+
+int main() {
+
+  printf("ramp of the master brightness from 0 to 255 in 2s\n");
+
+  static const uint8_t DEVICES[] = { 8, 64 };
+  static const uint32_t CLOCKS[] = { 100000, 400000 };
+
+  for (uint8_t d = 0; d < 2; d++) {
+    for (uint8_t c = 0; c < 2; c++) {
+      CHECK(rampShare(DEVICES[d], CLOCKS[c]) <= FLEET_RAMP_BUS_SHARE);
+    }
+  }
+
+  // small fleets keep the fixed minimum interval
+  HostBus::reset();
+  PCA9532Fleet fleet(&Wire);
+  fleet.begin();
+  fleet.addDevice(0x60);
+  CHECK_EQ(fleet.rampIntervalMicros(), FLEET_RAMP_INTERVAL_MICROS);
+
+  // PWM values queued by setPwm() go out with the master pass, which
+  // chains all devices in one transaction
+  for (uint8_t d = 1; d < 8; d++) {
+    fleet.addDevice(0x60 + d);
+  }
+  fleet.flush();
+  for (uint8_t d = 0; d < 8; d++) {
+    fleet.setPwm(d, REG_PWM0, 200);
+    fleet.setPwm(d, REG_PWM1, 100);
+  }
+  CHECK(fleet.isPending());
+  HostBus::resetStats();
+  fleet.setMasterBrightness(128);
+  CHECK_EQ(HostBus::transactions(), 1);
+  CHECK(!fleet.isPending());
+  fleet.flush();
+  CHECK_EQ(HostBus::transactions(), 1);
+  CHECK_EQ(HostBus::regs(0x67)[REG_PWM0], fleet.getReg(7, REG_PWM0));
+  CHECK_EQ(HostBus::regs(0x67)[REG_PWM1], fleet.getReg(7, REG_PWM1));
+
+  // a register other than PWM0/PWM1 is ignored
+  fleet.setPwm(3, REG_LS0, 0x55);
+  CHECK_EQ(fleet.getReg(3, REG_LS0), 0);
+  CHECK(!fleet.isPending());
+
+  return hostResult("test_fleet_ramp");
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Adaptive input poller: polls at the fast rate while inputs change,
+ * backs off when idle, reuses reads of other consumers but never its own
+ * previous sample, and counts only polls that went to the bus
+ */
+
+#include "HostTest.h"
+#include "PCA9532InputPoller.h"
+
+#define ADDRESS 0x60
+
+// run for a second of virtual time, sleeping until the poller or another
+// consumer of the inputs is due. With toggle set, an input changes right
+// after every poll; otherMicros is the read interval of the other consumer
+// (0 = none)
+static void run(PCA9532 &pca9532, PCA9532InputPoller &poller,
+                bool toggle, uint32_t otherMicros) {
+
+  uint16_t pins = 0xFFFF;
+
+  HostBus::setPinLevels(ADDRESS, pins);
+  poller.update();
+  if (toggle) {
+    pins ^= 1;
+    HostBus::setPinLevels(ADDRESS, pins);
+  }
+  pca9532.resetBusStats();
+  poller.resetStats();
+
+  uint32_t end = micros() + 1000000;
+  uint32_t other = micros();
+
+  while ((int32_t) (end - micros()) > 0) {
+
+    uint32_t wait = poller.nextDeadlineMicros();
+    if (otherMicros) {
+      uint32_t due = other + otherMicros - micros();
+      wait = due < wait ? due : wait;
+    }
+    delayMicroseconds(wait);
+
+    if (otherMicros && micros() - other >= otherMicros) {
+      other = micros();
+      pca9532.readInputs(0);
+    }
+    if (poller.nextDeadlineMicros() == 0) {
+      poller.update();
+      if (toggle) {
+        pins ^= 1;
+        HostBus::setPinLevels(ADDRESS, pins);
+      }
+    }
+  }
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  printf("input poller, fast 5ms, slow 200ms, 1s each\n");
+
+  // changing inputs: every poll 5ms after the previous one reads the bus,
+  // the own sample of exactly one interval ago is not reused
+  PCA9532InputPoller poller(&pca9532, 5000, 200000);
+  run(pca9532, poller, true, 0);
+  printf("  changing after every poll:  %3u polls, %3u events, max latency %lu us\n",
+         poller.getPollCount(), poller.getEventCount(), (unsigned long) poller.getMaxLatencyMicros());
+  CHECK(poller.getPollCount() >= 199 && poller.getPollCount() <= 201);
+  CHECK_EQ(poller.getEventCount(), poller.getPollCount());
+  CHECK_EQ(poller.getPollCount(), pca9532.getBusTransactions() / 2);
+  CHECK_EQ(poller.getMaxLatencyMicros(), 5000);
+
+  // idle inputs: the interval backs off to the slow bound
+  PCA9532InputPoller idle(&pca9532, 5000, 200000);
+  run(pca9532, idle, false, 0);
+  printf("  idle:                       %3u polls, interval %lu us\n",
+         idle.getPollCount(), (unsigned long) idle.getInterval());
+  CHECK(idle.getPollCount() <= 12);
+  CHECK_EQ(idle.getInterval(), 200000);
+  CHECK_EQ(idle.getPollCount(), pca9532.getBusTransactions() / 2);
+
+  // another consumer reads every 1ms: the poller reuses its reads, the
+  // bus sees the other consumer only
+  PCA9532InputPoller shared(&pca9532, 5000, 200000);
+  run(pca9532, shared, true, 1000);
+  printf("  shared with 1ms reads:      %3u polls, %3u events, %u bus reads\n",
+         shared.getPollCount(), shared.getEventCount(), pca9532.getBusTransactions() / 2);
+  CHECK_EQ(shared.getPollCount(), 0);
+  CHECK(pca9532.getBusTransactions() / 2 >= 999);
+  CHECK(shared.getEventCount() >= 199);
+  CHECK(shared.getMaxLatencyMicros() <= 5000 + 1000);
+
+  return hostResult("test_input_poller");
+}
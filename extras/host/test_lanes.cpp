@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Priority lanes: an alarm queued on PRIORITY_HIGH while bulk animation
+ * frames stream out reaches the device within one bulk transaction, and
+ * within 1ms at every clock once bulk bursts are capped where needed.
+ * Uncapped, a bulk burst of 8 registers alone takes over 1ms at 100kHz
+ */
+
+#include "HostTest.h"
+
+// Virtual time from the alarm being queued to its byte on the bus
+static uint64_t alarmLatency(PCA9532 &pca9532, uint32_t clockHz, uint16_t frameAtAlarm) {
+
+  HostBus::setTiming(HostBus::timingForClock(clockHz));
+  HostBus::clearLog();
+
+  uint64_t queued = 0;
+  uint8_t level = 0;
+
+  for (uint16_t frame = 0; frame < 200; frame++) {
+    for (uint8_t reg = REG_PSC0; reg <= REG_LS2; reg++) {
+      pca9532.queueReg(reg, level++);
+    }
+    if (frame == frameAtAlarm) {
+      // the alarm is raised while a bulk burst is on the bus, it waits
+      // for the end of that burst and goes out with the next transaction
+      queued = HostBus::nanos();
+      pca9532.flushStep();
+      pca9532.queueReg(REG_LS3, 0x55, PRIORITY_HIGH);
+      pca9532.flushStep();
+      break;
+    }
+    pca9532.flush();
+  }
+  pca9532.flush();
+
+  const std::vector<HostWrite> &log = HostBus::log();
+  for (size_t i = 0; i < log.size(); i++) {
+    if (log[i].reg == REG_LS3 && log[i].value == 0x55) {
+      return log[i].nanos - queued;
+    }
+  }
+
+  return ~0ULL;
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(0x60, &Wire);
+
+  printf("alarm latency, bulk frames of 7 registers\n");
+
+  // longest bulk burst per clock that keeps an alarm within 1ms
+  static const uint32_t CLOCKS[] = { 100000, 400000, 1000000 };
+  static const uint8_t BURSTS[] = { 4, REG_COUNT, REG_COUNT };
+  for (uint8_t c = 0; c < 3; c++) {
+    pca9532.setBusProfile(PCA9532::busProfileForClock(CLOCKS[c]));
+
+    // uncapped first where a cap is needed
+    for (uint8_t capped = BURSTS[c] < REG_COUNT ? 0 : 1; capped < 2; capped++) {
+      uint8_t burst = capped ? BURSTS[c] : REG_COUNT;
+      pca9532.setMaxBulkBurst(burst);
+
+      uint64_t worst = 0;
+      for (uint16_t frame = 0; frame < 50; frame++) {
+        uint64_t latency = alarmLatency(pca9532, CLOCKS[c], frame);
+        worst = latency > worst ? latency : worst;
+      }
+
+      // longest bulk burst (address, control and at most 8 data bytes),
+      // then the alarm transaction (address, control and one data byte)
+      uint8_t data = burst < 8 ? burst : 8;
+      uint64_t bound = (uint64_t) pca9532.estimateBusMicros(2, 2 + data + 3) * 1000;
+      printf("  %7lu Hz, bulk bursts up to %u registers: worst %7llu ns, bound %7llu ns\n",
+             (unsigned long) CLOCKS[c], data, (unsigned long long) worst, (unsigned long long) bound);
+      CHECK(worst <= bound);
+      if (capped) {
+        CHECK(worst <= 1000000);
+      }
+    }
+  }
+  pca9532.setMaxBulkBurst(REG_COUNT);
+
+  // the alarm goes out before pending bulk registers
+  HostBus::clearLog();
+  for (uint8_t reg = REG_PSC0; reg <= REG_LS2; reg++) {
+    pca9532.queueReg(reg, reg);
+  }
+  pca9532.queueReg(REG_LS3, 0xAA, PRIORITY_HIGH);
+  pca9532.flushStep();
+  CHECK(!HostBus::log().empty());
+  CHECK_EQ(HostBus::log()[0].reg, REG_LS3);
+  CHECK_EQ(HostBus::log().size(), 1);
+  pca9532.flush();
+  CHECK_EQ(HostBus::regs(0x60)[REG_LS2], REG_LS2);
+
+  // capped bulk bursts split a run, the estimate splits it the same way
+  pca9532.setMaxBulkBurst(3);
+  for (uint8_t reg = REG_PSC0; reg <= REG_LS2; reg++) {
+    pca9532.queueReg(reg, reg + 1);
+  }
+  PCA9532BusCost cost = pca9532.estimateFlush();
+  HostBus::resetStats();
+  pca9532.flush();
+  CHECK_EQ(HostBus::transactions(), 3);
+  CHECK_EQ(cost.transactions, HostBus::transactions());
+  CHECK_EQ(cost.bytes, HostBus::bytes());
+  CHECK_EQ(HostBus::regs(0x60)[REG_LS2], REG_LS2 + 1);
+
+  return hostResult("test_lanes");
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Reflexes: a loop around flushAndReadInputs() turns an output on within
+ * one loop iteration of the input changing, while animation frames keep
+ * streaming. Reflex entries with an output above LED15 are ignored
+ */
+
+#include "HostTest.h"
+
+#define ADDRESS 0x62
+#define BUTTON  (1 << 8) // LED8 used as input
+
+// bus time of the write that turned LED0 on, 0 if none
+static uint64_t ledOnNanos(uint64_t after) {
+
+  const std::vector<HostWrite> &log = HostBus::log();
+
+  for (size_t i = 0; i < log.size(); i++) {
+    if (log[i].nanos >= after && log[i].address == ADDRESS && log[i].reg == REG_LS0
+        && (log[i].value & 0b11) == LS_STATE_ON) {
+      return log[i].nanos;
+    }
+  }
+
+  return 0;
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  static const PCA9532Reflex reflexes[] = {
+    { BUTTON, 0, 200, LS_STATE_ON },      // out of range, ignored
+    { BUTTON, 0, 0, LS_STATE_ON },        // pressed: LED0 on
+    { BUTTON, BUTTON, 0, LS_STATE_OFF },  // released: LED0 off
+    { BUTTON, 0, 255, LS_STATE_BLNK1 },   // out of range, ignored
+  };
+  pca9532.setReflexes(reflexes, 4);
+
+  // one loop iteration with a frame of animation and nothing pressed
+  pca9532.flushAndReadInputs();
+  uint64_t start = HostBus::nanos();
+  pca9532.queueReg(REG_PWM0, 1);
+  pca9532.flushAndReadInputs();
+  uint64_t iteration = HostBus::nanos() - start;
+
+  printf("reflex loop, one frame and the inputs per iteration\n");
+
+  uint64_t worst = 0;
+
+  for (uint8_t press = 0; press < 20; press++) {
+    // the button goes down somewhere between two iterations
+    HostBus::advance(press * iteration / 20);
+    HostBus::clearLog();
+    uint64_t pressed = HostBus::nanos();
+    HostBus::setPinLevels(ADDRESS, 0xFFFF & ~BUTTON);
+
+    for (uint8_t i = 0; i < 3; i++) {
+      pca9532.queueReg(REG_PWM0, press + i);
+      pca9532.flushAndReadInputs();
+    }
+    uint64_t on = ledOnNanos(pressed);
+    CHECK(on != 0);
+    worst = std::max(worst, on - pressed);
+
+    HostBus::setPinLevels(ADDRESS, 0xFFFF);
+    for (uint8_t i = 0; i < 3; i++) {
+      pca9532.flushAndReadInputs();
+    }
+    CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS0] & 0b11, LS_STATE_OFF);
+  }
+
+  // the iteration that reads the press plus the reflex write
+  uint64_t bound = iteration + pca9532.estimateBusMicros(1, 3) * 1000ULL;
+  printf("  iteration %llu us, worst press to LED0 %llu us, bound %llu us\n",
+         (unsigned long long) iteration / 1000, (unsigned long long) worst / 1000,
+         (unsigned long long) bound / 1000);
+  CHECK(worst <= bound);
+
+  // the ignored entries left every other register alone
+  CHECK_EQ(pca9532.getRegImage(REG_LS1), 0);
+  CHECK_EQ(pca9532.getRegImage(REG_LS2), 0);
+  CHECK_EQ(pca9532.getRegImage(REG_LS3), 0);
+  CHECK_EQ(pca9532.getRegImage(REG_PWM1), 0x80);
+  CHECK(!pca9532.isPending(PRIORITY_HIGH));
+
+  return hostResult("test_reflex");
+}
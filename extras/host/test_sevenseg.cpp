@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Seven-segment display: numbers that do not fit, minus sign included,
+ * show the overflow pattern, a display without digits is left alone
+ */
+
+#include "HostTest.h"
+#include "PCA9532SevenSeg.h"
+
+#define ADDRESS 0x62
+
+// segments of a digit as the device shows them
+static uint8_t shown(uint8_t digit) {
+
+  const uint8_t *regs = HostBus::regs(ADDRESS);
+  uint8_t segments = 0;
+
+  for (uint8_t i = 0; i < 8; i++) {
+    uint8_t output = (digit & 1) * 8 + i;
+    if ((regs[REG_LS0 + (output >> 2)] >> ((output & 3) * 2)) & 0b11) {
+      segments |= 1 << i;
+    }
+  }
+
+  return segments;
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  PCA9532 *devices[] = { &pca9532 };
+  PCA9532SevenSeg display(devices, 1);
+  display.begin();
+
+  printf("seven-segment display, 2 digits\n");
+
+  display.printNumber(-4);
+  display.update();
+  CHECK_EQ(shown(0), SEG_G);
+  CHECK_EQ(shown(1), SEG_B | SEG_C | SEG_F | SEG_G);
+
+  display.printNumber(-4, true);
+  display.update();
+  CHECK_EQ(shown(0), SEG_G);
+
+  // the minus sign has no room left
+  display.printNumber(-42);
+  display.update();
+  printf("  -42: 0x%02X 0x%02X\n", shown(0), shown(1));
+  CHECK_EQ(shown(0), SEG_OVERFLOW);
+  CHECK_EQ(shown(1), SEG_OVERFLOW);
+
+  display.printNumber(99);
+  display.update();
+  CHECK_EQ(shown(0), SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G);
+
+  display.printNumber(123);
+  display.update();
+  CHECK_EQ(shown(0), SEG_OVERFLOW);
+  CHECK_EQ(shown(1), SEG_OVERFLOW);
+
+  display.printHex(0x100);
+  display.update();
+  CHECK_EQ(shown(1), SEG_OVERFLOW);
+
+  display.printHex(0xFF);
+  display.update();
+  CHECK_EQ(shown(1), SEG_A | SEG_E | SEG_F | SEG_G);
+
+  // no digits at all: nothing to print to
+  PCA9532SevenSeg empty(devices, 0);
+  HostBus::resetStats();
+  empty.printNumber(-7);
+  empty.printHex(0);
+  empty.update();
+  CHECK_EQ(HostBus::transactions(), 0);
+
+  return hostResult("test_sevenseg");
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Keyframe timeline: a seek before the first keyframe of a track shows the
+ * power-on image, a keyframe hours ahead does not wrap the deadline
+ */
+
+#include "HostTest.h"
+#include "PCA9532Timeline.h"
+
+#define ADDRESS 0x62
+
+static uint32_t showTime;
+
+static uint32_t showClock() {
+
+  return showTime;
+}
+
+int main() {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+
+  // PSC0 PWM0 PSC1 PWM1 LS0 LS1 LS2 LS3
+  static const PCA9532Keyframe keyframes[] = {
+    { 1000, { 1, 0x10, 2, 0x20, 0x55, 0xAA, 0x55, 0xAA } },
+    { 2000, { 3, 0x30, 4, 0x40, 0xFF, 0x00, 0xFF, 0x00 } },
+    { 2000 + 2 * 3600000UL, { 0, 0x00, 0, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+  };
+  PCA9532Track tracks[] = { { &pca9532, keyframes, 3 } };
+
+  PCA9532Timeline timeline(tracks, 1);
+  timeline.setTimeSource(showClock);
+
+  printf("keyframe timeline\n");
+
+  // seek into the show, then back before its first keyframe
+  timeline.seek(1500);
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_LS0], 0x55);
+  timeline.seek(500);
+  static const uint8_t powerOn[REG_COUNT] = { 0, 0, 0, 0x80, 0, 0x80, 0, 0, 0, 0 };
+  for (uint8_t reg = REG_PSC0; reg < REG_COUNT; reg++) {
+    CHECK_EQ(HostBus::regs(ADDRESS)[reg], powerOn[reg]);
+  }
+  printf("  seek before the first keyframe: PWM0 0x%02X, LS0 0x%02X\n",
+         HostBus::regs(ADDRESS)[REG_PWM0], HostBus::regs(ADDRESS)[REG_LS0]);
+
+  // playing from there picks up the first keyframe on time
+  showTime = 500;
+  timeline.play(500);
+  CHECK_EQ(timeline.nextDeadlineMicros(), 500000UL);
+  showTime = 1000;
+  timeline.update();
+  CHECK_EQ(HostBus::regs(ADDRESS)[REG_PWM0], 0x10);
+
+  // the last keyframe is two hours after the second
+  showTime = 2000;
+  timeline.update();
+  uint32_t deadline = timeline.nextDeadlineMicros();
+  printf("  keyframe 2h ahead: deadline %lu us\n", (unsigned long) deadline);
+  CHECK_EQ(deadline, NO_DEADLINE - 1);
+  showTime = 2000 + 2 * 3600000UL - 60000;
+  CHECK_EQ(timeline.nextDeadlineMicros(), 60000000UL);
+
+  return hostResult("test_timeline");
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/*
+ * Virtual panel: brightness from the register timeline including the
+ * hardware blink, and a golden comparison of what an animation looks like
+ * when the lookahead planner saves bus bytes. Set UPDATE_GOLDEN=1 to
+ * rewrite the golden files in golden/
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "HostTest.h"
+#include "PCA9532Lookahead.h"
+#include "PCA9532Panel.h"
+#include "VirtualPanel.h"
+
+#define ADDRESS 0x62
+
+#define FRAMES      48
+#define FRAME_NANOS 40000000ULL
+#define MAX_ERROR   8
+
+// five whole 152Hz blink periods (PSC = 0) at the end of every frame
+#define SETTLE_NANOS (FRAME_NANOS - 5000ULL * PCA9532Panel::blinkPeriodMicros(0))
+
+static uint8_t levels[FRAMES][LOOKAHEAD_OUTPUTS];
+
+static void advanceTo(uint64_t nanos) {
+
+  if (nanos > HostBus::nanos()) {
+    HostBus::advance(nanos - HostBus::nanos());
+  }
+}
+
+// one frame per slot through the planner, the window is filled up front
+static uint32_t render(uint8_t window, VirtualPanel &panel) {
+
+  HostBus::reset();
+
+  PCA9532 pca9532(REG_PWM0, REG_PWM1);
+  pca9532.begin(ADDRESS, &Wire);
+  PCA9532Lookahead lookahead(&pca9532, window, MAX_ERROR);
+
+  uint16_t pushed = 0;
+
+  for (uint16_t slot = 0; slot < FRAMES; slot++) {
+    advanceTo((slot + 1) * FRAME_NANOS);
+    bool queued = false;
+    while (!queued && pushed < FRAMES) {
+      queued = lookahead.push(levels[pushed++]);
+    }
+    if (!queued) {
+      lookahead.drain();
+    }
+    pca9532.flush();
+  }
+  advanceTo((FRAMES + 1) * FRAME_NANOS);
+
+  panel.update();
+
+  return lookahead.getBusBytes();
+}
+
+static std::string readFile(const char *path) {
+
+  std::string text;
+  FILE *file = fopen(path, "r");
+  if (file) {
+    char buffer[256];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      text.append(buffer, length);
+    }
+    fclose(file);
+  }
+
+  return text;
+}
+
+// export the frames, compare the CSV with the golden one
+static void golden(const VirtualPanel &panel, const char *name) {
+
+  std::string csv = std::string("build/") + name + ".csv";
+  std::string ppm = std::string("build/") + name + ".ppm";
+  std::string gold = std::string("golden/") + name + ".csv";
+
+  FILE *file = fopen(csv.c_str(), "w");
+  panel.writeCsv(file, FRAME_NANOS, FRAME_NANOS, SETTLE_NANOS, FRAMES);
+  fclose(file);
+  file = fopen(ppm.c_str(), "w");
+  panel.writePpm(file, FRAME_NANOS, FRAME_NANOS, SETTLE_NANOS, FRAMES);
+  fclose(file);
+
+  const char *update = getenv("UPDATE_GOLDEN");
+  if (update && strcmp(update, "1") == 0) {
+    file = fopen(gold.c_str(), "w");
+    std::string text = readFile(csv.c_str());
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+  }
+
+  CHECK(readFile(csv.c_str()).size() > 0);
+  CHECK(readFile(csv.c_str()) == readFile(gold.c_str()));
+}
+
+int main() {
+
+  // register timeline: blink, PWM change and LS changes within a window
+  HostBus::reset();
+  {
+    PCA9532 pca9532(REG_PWM0, REG_PWM1);
+    pca9532.begin(ADDRESS, &Wire);
+    VirtualPanel panel(ADDRESS);
+
+    pca9532.setBlinking(REG_PSC0, BLINKING_PERIOD_1_S);
+    pca9532.setPwm(REG_PWM0, 64);
+    pca9532.setLsState(LS_STATE_BLNK0, REG_LS0, BIT_LS_LED0);
+    advanceTo(1000000000ULL);
+    pca9532.setLsState(LS_STATE_ON, REG_LS0, BIT_LS_LED1);
+    advanceTo(1500000000ULL);
+    pca9532.setLsState(LS_STATE_OFF, REG_LS0, BIT_LS_LED1);
+    advanceTo(3000000000ULL);
+    pca9532.setPwm(REG_PWM0, 192);
+    advanceTo(5000000000ULL);
+    panel.update();
+
+    printf("virtual panel, LED0 blinking at 1s, LED1 on for 0.5s\n");
+    CHECK_EQ(panel.level(0, 0), 0);
+    CHECK_EQ(panel.level(0, 1100000000ULL), 255);
+    CHECK_EQ(panel.level(0, 1300000000ULL), 0);
+    CHECK_EQ(panel.brightness(0, 1000000000ULL, 2000000000ULL), 63);
+    CHECK_EQ(panel.brightness(0, 4000000000ULL, 5000000000ULL), 191);
+    // half of the window at PWM 64, half at PWM 192
+    CHECK_EQ(panel.brightness(0, 2500000000ULL, 3500000000ULL), 127);
+    CHECK_EQ(panel.brightness(1, 500000000ULL, 2000000000ULL), 85);
+    CHECK_EQ(panel.level(1, 1400000000ULL), 255);
+    CHECK_EQ(panel.level(1, 1600000000ULL), 0);
+
+    // registers never written keep their power-on value
+    uint8_t image[REG_COUNT];
+    panel.image(4000000000ULL, image);
+    CHECK_EQ(image[REG_PSC0], BLINKING_PERIOD_1_S);
+    CHECK_EQ(image[REG_PWM0], 192);
+    CHECK_EQ(image[REG_PWM1], 0x80);
+  }
+
+  // outputs off, on and on two slow ramps with a few levels of jitter,
+  // which fits the two PWM channels
+  for (uint16_t frame = 0; frame < FRAMES; frame++) {
+    for (uint8_t output = 0; output < LOOKAHEAD_OUTPUTS; output++) {
+      int8_t jitter = (int8_t) ((frame * 7 + output * 5) % 7) - 3;
+      switch (output & 3) {
+        case 0:
+          levels[frame][output] = 0;
+          break;
+        case 1:
+          levels[frame][output] = 255;
+          break;
+        case 2:
+          levels[frame][output] = 40 + frame * 3 + jitter;
+          break;
+        default:
+          levels[frame][output] = 200 - frame * 2 + jitter;
+          break;
+      }
+    }
+  }
+
+  // what people see must stay within the error the planner is allowed,
+  // however many bus bytes looking ahead saves
+  VirtualPanel greedy(ADDRESS), ahead(ADDRESS);
+  uint32_t greedyBytes = render(1, greedy);
+  uint32_t aheadBytes = render(PCA9532_LOOKAHEAD_MAX_WINDOW, ahead);
+
+  uint8_t seenGreedy[FRAMES][PANEL_OUTPUTS], seenAhead[FRAMES][PANEL_OUTPUTS];
+  greedy.frames(FRAME_NANOS, FRAME_NANOS, SETTLE_NANOS, FRAMES, seenGreedy[0]);
+  ahead.frames(FRAME_NANOS, FRAME_NANOS, SETTLE_NANOS, FRAMES, seenAhead[0]);
+
+  int worstGreedy = 0, worstAhead = 0;
+  for (uint16_t frame = 0; frame < FRAMES; frame++) {
+    for (uint8_t output = 0; output < PANEL_OUTPUTS; output++) {
+      worstGreedy = std::max(worstGreedy, abs(seenGreedy[frame][output] - levels[frame][output]));
+      worstAhead = std::max(worstAhead, abs(seenAhead[frame][output] - levels[frame][output]));
+    }
+  }
+
+  printf("  window 1: %4u bytes, worst error %d\n", greedyBytes, worstGreedy);
+  printf("  window %u: %4u bytes, worst error %d\n", PCA9532_LOOKAHEAD_MAX_WINDOW, aheadBytes, worstAhead);
+  // PWM n is on for n / 256 of the period, one more for the rounding
+  CHECK(worstGreedy <= MAX_ERROR + 2);
+  CHECK(worstAhead <= MAX_ERROR + 2);
+  CHECK(aheadBytes <= greedyBytes);
+
+  golden(ahead, "panel_lookahead");
+
+  return hostResult("test_virtual_panel");
+}
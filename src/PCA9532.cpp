@@ -8,6 +8,8 @@
 
 #include "PCA9532.h"
 
+const uint8_t PCA9532::POWER_ON_REGS[REG_COUNT] = { 0x00, 0x00, 0x00, 0x80, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00 };
+
 /******************************* PUBLIC METHODS *******************************/
 
 
@@ -21,6 +23,28 @@ PCA9532::PCA9532(uint8_t regPwm1, uint8_t regPwm2) {
 
   _regPwm1 = regPwm1;
   _regPwm2 = regPwm2;
+
+  memcpy(_regImage, POWER_ON_REGS, sizeof(_regImage));
+
+  for (uint8_t i = 0; i < PRIORITY_LANES; i++) {
+    _dirty[i] = 0;
+  }
+
+  _inputs = 0;
+  _inputsMicros = 0;
+  _inputsValid = false;
+
+  _reflexes = NULL;
+  _reflexCount = 0;
+
+  _deterministic = false;
+
+  resetBusStats();
+
+  _busProfile = busProfileForClock(100000);
+
+  _retries = BUS_RETRIES;
+  _maxBulkBurst = REG_COUNT;
 }
 
     /**
@@ -45,6 +69,15 @@ void PCA9532::begin(uint8_t deviceAddress, TwoWire *wire) {
      */
 void PCA9532::turnOn() {
 
+  if (_deterministic) {
+    _regImage[REG_LS0] = _storedRegLs0;
+    _regImage[REG_LS1] = _storedRegLs1;
+    _regImage[REG_LS2] = _storedRegLs2;
+    _regImage[REG_LS3] = _storedRegLs3;
+    writeDirect(REG_LS0, 4);
+    return;
+  }
+
   writeReg(REG_LS0, _storedRegLs0);
   writeReg(REG_LS1, _storedRegLs1);
   writeReg(REG_LS2, _storedRegLs2);
@@ -60,6 +93,16 @@ void PCA9532::turnOn() {
      */
 void PCA9532::turnOff() {
 
+  if (_deterministic) {
+    _storedRegLs0 = _regImage[REG_LS0];
+    _storedRegLs1 = _regImage[REG_LS1];
+    _storedRegLs2 = _regImage[REG_LS2];
+    _storedRegLs3 = _regImage[REG_LS3];
+    memset(&_regImage[REG_LS0], LS_STATE_OFF, 4);
+    writeDirect(REG_LS0, 4);
+    return;
+  }
+
   _storedRegLs0 = readReg(REG_LS0);
   writeReg(REG_LS0, LS_STATE_OFF);
   _storedRegLs1 = readReg(REG_LS1);
@@ -88,6 +131,14 @@ void PCA9532::setPwm(uint8_t regPwm, uint8_t pwm) {
      */
 void PCA9532::setGrpPwm(uint8_t pwm) {
 
+  if (_deterministic) {
+    // PWM0, PSC1 and PWM1 in one burst instead of two transactions
+    _regImage[REG_PWM0] = pwm;
+    _regImage[REG_PWM1] = pwm;
+    writeDirect(REG_PWM0, 3);
+    return;
+  }
+
   writeReg(REG_PWM0, pwm);
   writeReg(REG_PWM1, pwm);
 }
@@ -114,14 +165,9 @@ void PCA9532::setBlinking(uint8_t regPsc, uint8_t blinkPeriod) {
     */
 void PCA9532::setLsState(uint8_t state, uint8_t regLs, uint8_t lsBit) {
 
-  uint8_t prevReg = readReg(regLs);
-  uint8_t newReg;
+  uint8_t prevReg = _deterministic ? _regImage[regLs] : readReg(regLs);
 
-  newReg = prevReg & ~(0b11 << lsBit);
-
-  newReg |= (state << lsBit);
-
-  writeReg(regLs, newReg);
+  writeReg(regLs, packLsState(prevReg, state, lsBit));
 }
 
     /**
@@ -135,33 +181,540 @@ void PCA9532::setLsState(uint8_t state, uint8_t regLs, uint8_t lsBit) {
     */
 void PCA9532::setLsStateAll(uint8_t state) {
 
-  uint8_t newReg = ( state << BIT_LS_LED3
-                   | state << BIT_LS_LED2
-                   | state << BIT_LS_LED1
-                   | state << BIT_LS_LED0);
+  uint8_t newReg = packLsStateAll(state);
+
+  if (_deterministic) {
+    // all four LS registers share the same pattern
+    memset(&_regImage[REG_LS0], newReg, 4);
+    writeDirect(REG_LS0, 4);
+    return;
+  }
 
   writeReg(REG_LS0, newReg);
+  writeReg(REG_LS1, newReg);
+  writeReg(REG_LS2, newReg);
+  writeReg(REG_LS3, newReg);
+}
 
-  newReg = ( state << BIT_LS_LED7
-           | state << BIT_LS_LED6
-           | state << BIT_LS_LED5
-           | state << BIT_LS_LED4);
+    /**
+     * LS register value with the state of one channel replaced. Pure
+     * function, no bus access
+     *
+     * @param regValue Current value of the LS register
+     * @param state    One of the four possible states
+     * @param lsBit    Lower bit of LS* (see BIT_LS_LED*)
+     *
+     * @return new LS register value
+     */
+uint8_t PCA9532::packLsState(uint8_t regValue, uint8_t state, uint8_t lsBit) {
 
-  writeReg(REG_LS1, newReg);
+  return (regValue & ~(0b11 << lsBit)) | (state << lsBit);
+}
 
-  newReg = ( state << BIT_LS_LED11
-           | state << BIT_LS_LED10
-           | state << BIT_LS_LED9
-           | state << BIT_LS_LED8);
+    /**
+     * LS register value with all four channels in the same state. Pure
+     * function, no bus access
+     *
+     * @param state One of the four possible states
+     *
+     * @return LS register value
+     */
+uint8_t PCA9532::packLsStateAll(uint8_t state) {
 
-  writeReg(REG_LS2, newReg);
+  // one multiply replaces the shift/OR chain: 0x55 repeats the two state
+  // bits in all four fields (BIT_LS_LEDn is 0, 2, 4, 6 in every register)
+  return (state & 0b11) * 0x55;
+}
 
-  newReg = ( state << BIT_LS_LED15
-           | state << BIT_LS_LED14
-           | state << BIT_LS_LED13
-           | state << BIT_LS_LED12);
+    /**
+     * Queue a register write without touching the bus. The value is stored
+     * in the register image and sent by flush() or flushStep()
+     *
+     * A register queued on PRIORITY_HIGH is sent at the next transaction
+     * boundary, ahead of all registers pending on PRIORITY_BULK
+     *
+     * @param registerAddress Register address to write to
+     * @param data            Data to write
+     * @param priority        PRIORITY_BULK or PRIORITY_HIGH
+     */
+void PCA9532::queueReg(uint8_t registerAddress, uint8_t data, uint8_t priority) {
 
-  writeReg(REG_LS3, newReg);
+  if (registerAddress < REG_PSC0 || registerAddress >= REG_COUNT) {
+    return;
+  }
+
+  uint16_t bit = 1 << registerAddress;
+
+  _regImage[registerAddress] = data;
+
+  if (priority == PRIORITY_HIGH || (_dirty[PRIORITY_HIGH] & bit)) {
+    // an urgent register stays urgent until it has been sent
+    _dirty[PRIORITY_BULK] &= ~bit;
+    _dirty[PRIORITY_HIGH] |= bit;
+  } else {
+    _dirty[PRIORITY_BULK] |= bit;
+  }
+}
+
+    /**
+     * Queue the LED output state for a given channel (see setLsState()).
+     * Modifies the register image only, no read before write is required
+     *
+     * @param state    One of the four possible states
+     * @param regLs    Register address of LS*
+     * @param lsBit    Lower bit of LS* (see BIT_LS_LED*)
+     * @param priority PRIORITY_BULK or PRIORITY_HIGH
+     */
+void PCA9532::queueLsState(uint8_t state, uint8_t regLs, uint8_t lsBit,
+                           uint8_t priority) {
+
+  queueReg(regLs, packLsState(_regImage[regLs], state, lsBit), priority);
+}
+
+    /**
+     * Send one transaction of pending register updates. High-priority
+     * registers are always sent first; bulk registers are sent as one burst
+     * of consecutive dirty registers per call, at most the length set with
+     * setMaxBulkBurst()
+     *
+     * @return true if a transaction was sent
+     * @return false if nothing was pending or the transaction failed
+     */
+bool PCA9532::flushStep() {
+
+  uint8_t lane = _dirty[PRIORITY_HIGH] ? PRIORITY_HIGH : PRIORITY_BULK;
+  uint16_t dirty = _dirty[lane];
+
+  if (dirty == 0) {
+    return false;
+  }
+
+  uint8_t first, length;
+  findRun(dirty, lane == PRIORITY_BULK ? _maxBulkBurst : REG_COUNT, first, length);
+
+  return writeImage(first, length);
+}
+
+    /**
+     * Send all pending register updates, one transaction at a time.
+     * Updates queued on PRIORITY_HIGH between two transactions overtake
+     * the remaining bulk bursts. Stops at the first failed transaction,
+     * the failed registers stay pending. One transaction per call in
+     * deterministic mode
+     */
+void PCA9532::flush() {
+
+  if (_deterministic) {
+    flushStep();
+    return;
+  }
+
+  while (flushStep()) {
+  }
+}
+
+    /**
+     * Check for pending register updates
+     *
+     * @param priority PRIORITY_BULK or PRIORITY_HIGH
+     *
+     * @return true if registers of the given lane are waiting to be sent
+     */
+bool PCA9532::isPending(uint8_t priority) const {
+
+  return _dirty[priority] != 0;
+}
+
+    /**
+     * Time until the driver needs to run again. Queued register updates
+     * are due immediately, otherwise the driver has nothing scheduled
+     *
+     * @return microseconds until flush() is due (0 = now)
+     * @return NO_DEADLINE if nothing is pending
+     */
+uint32_t PCA9532::nextDeadlineMicros() const {
+
+  return (_dirty[PRIORITY_HIGH] | _dirty[PRIORITY_BULK]) ? 0 : NO_DEADLINE;
+}
+
+    /**
+     * Get a register from the register image (no bus access)
+     *
+     * @param registerAddress Register address to get
+     *
+     * @return last value written or queued for the register
+     */
+uint8_t PCA9532::getRegImage(uint8_t registerAddress) const {
+
+  return _regImage[registerAddress];
+}
+
+    /**
+     * Read the input registers INPUT0 and INPUT1, shared by all consumers.
+     * The cached inputs are returned if they are not older than maxAgeMicros,
+     * otherwise both registers are refreshed in one burst read. Each consumer
+     * passes its own freshness requirement, so the bus is polled only as often
+     * as the strictest consumer requires
+     *
+     * @param maxAgeMicros Maximum age of the cached inputs in microseconds
+     *                     (0 always reads from the device)
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+uint16_t PCA9532::readInputs(uint32_t maxAgeMicros) {
+
+  uint32_t now = micros();
+
+  if (_inputsValid && maxAgeMicros > 0 && now - _inputsMicros <= maxAgeMicros) {
+    return _inputs;
+  }
+
+  uint8_t data[2];
+
+  if (readBurst(REG_INPUT0, data, 2)) {
+    _inputs = (uint16_t) data[1] << 8 | data[0];
+    _inputsMicros = now;
+    _inputsValid = true;
+  }
+
+  return _inputs;
+}
+
+    /**
+     * Send all pending register updates and read INPUT0/INPUT1 in a single
+     * bus transaction: the bursts and the input read are chained with
+     * repeated STARTs and only the read ends with a STOP. The inputs are then
+     * evaluated against the reflex table, reflex outputs that change are
+     * sent at once on PRIORITY_HIGH
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+uint16_t PCA9532::flushAndReadInputs() {
+
+  bool chained = false;
+
+  for (int8_t lane = PRIORITY_LANES - 1; lane >= 0; lane--) {
+    // one burst per call in deterministic mode, the rest follows next call
+    while (_dirty[lane] && !(_deterministic && chained)) {
+
+      uint8_t first, length;
+      findRun(_dirty[lane], REG_COUNT, first, length);
+      uint16_t mask = ((1 << length) - 1) << first;
+
+      _wire->beginTransmission(_deviceAddress);
+      _wire->write(AUTO_INCREMENT | first);
+      for (uint8_t i = 0; i < length; i++) {
+        _wire->write(_regImage[first + i]);
+      }
+      uint8_t status = _wire->endTransmission(false);
+
+      _busBytes += 2 + length;
+
+      if (status != 0) {
+        // the bus was released, fall back to a plain read
+        _busTransactions++;
+        _busErrors++;
+        return readInputs(0);
+      }
+
+      _dirty[lane] &= ~mask;
+      chained = true;
+    }
+  }
+
+  uint8_t data[2];
+
+  if (readBurst(REG_INPUT0, data, 2, true)) {
+    _inputs = (uint16_t) data[1] << 8 | data[0];
+    _inputsMicros = micros();
+    _inputsValid = true;
+  }
+
+  for (uint8_t i = 0; i < _reflexCount; i++) {
+    const PCA9532Reflex &reflex = _reflexes[i];
+    if (reflex.output > 15) {
+      continue;
+    }
+    if ((_inputs & reflex.inputMask) == reflex.inputValue) {
+      uint8_t regLs = REG_LS0 + (reflex.output >> 2);
+      uint8_t lsBit = (reflex.output & 3) << 1;
+      if (((_regImage[regLs] >> lsBit) & 0b11) != reflex.state) {
+        queueLsState(reflex.state, regLs, lsBit, PRIORITY_HIGH);
+      }
+    }
+  }
+
+  if (_deterministic) {
+    // reflex outputs go out with the first burst of the next call
+    return _inputs;
+  }
+
+  while (_dirty[PRIORITY_HIGH] && flushStep()) {
+  }
+
+  return _inputs;
+}
+
+    /**
+     * Set the reflex table evaluated by flushAndReadInputs(). Entries are
+     * evaluated in order, a later matching entry overrides an earlier one
+     * for the same output. Entries with an output above LED15 are ignored
+     *
+     * @param reflexes Reflex table, must stay valid while in use (NULL = none)
+     * @param count    Number of entries
+     */
+void PCA9532::setReflexes(const PCA9532Reflex *reflexes, uint8_t count) {
+
+  _reflexes = reflexes;
+  _reflexCount = reflexes ? count : 0;
+}
+
+    /**
+     * Enable or disable deterministic-timing mode. In this mode every public
+     * call is served from the register image, never reads before writing and
+     * sends a fixed number of bus bytes (see PCA9532.h for the bounds)
+     *
+     * Enabling the mode reads PSC0 to LS3 once in a single burst to make the
+     * register image match the device. Registers queued but not sent yet
+     * keep their queued value and stay pending
+     *
+     * @param enable true to enable deterministic-timing mode
+     *
+     * @return true if the mode is enabled as requested
+     * @return false if the register image could not be read, the mode
+     *         stays disabled
+     */
+bool PCA9532::setDeterministic(bool enable) {
+
+  if (enable && !_deterministic) {
+
+    uint8_t device[REG_COUNT - REG_PSC0];
+    uint16_t pending = _dirty[PRIORITY_BULK] | _dirty[PRIORITY_HIGH];
+
+    if (!readBurst(REG_PSC0, device, REG_COUNT - REG_PSC0)) {
+      return false;
+    }
+
+    for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+      if (!(pending & (1 << r))) {
+        _regImage[r] = device[r - REG_PSC0];
+      }
+    }
+  }
+
+  _deterministic = enable;
+
+  return true;
+}
+
+    /**
+     * Number of bytes sent or received on the bus since the last
+     * resetBusStats(), address bytes included
+     *
+     * @return bus bytes
+     */
+uint32_t PCA9532::getBusBytes() const {
+
+  return _busBytes;
+}
+
+    /**
+     * Number of transactions (START to STOP) since the last resetBusStats()
+     *
+     * @return bus transactions
+     */
+uint32_t PCA9532::getBusTransactions() const {
+
+  return _busTransactions;
+}
+
+    /**
+     * Reset the bus statistics
+     */
+void PCA9532::resetBusStats() {
+
+  _busBytes = 0;
+  _busTransactions = 0;
+  _busErrors = 0;
+}
+
+    /**
+     * Set the number of retries of a failed burst sent by flush(),
+     * flushStep() or resync() (default BUS_RETRIES). Registers whose write
+     * still fails stay pending and are sent again by the next flush().
+     * Direct writes such as setPwm() make a single attempt, and there are
+     * no retries in deterministic mode
+     *
+     * @param retries Number of retries
+     */
+void PCA9532::setRetries(uint8_t retries) {
+
+  _retries = retries;
+}
+
+    /**
+     * Set the longest burst flushStep() and flush() send from PRIORITY_BULK.
+     * A register queued on PRIORITY_HIGH waits for at most one bulk burst,
+     * so this bounds its latency, e.g. 4 registers keep it under 1ms at
+     * 100kHz. Longer runs of pending bulk registers are split (default
+     * REG_COUNT, no limit)
+     *
+     * @param registers Registers per bulk burst (at least 1)
+     */
+void PCA9532::setMaxBulkBurst(uint8_t registers) {
+
+  _maxBulkBurst = registers < 1 ? 1 : registers;
+}
+
+    /**
+     * Number of transactions that failed after all retries since the last
+     * resetBusStats()
+     *
+     * @return bus errors
+     */
+uint32_t PCA9532::getBusErrors() const {
+
+  return _busErrors;
+}
+
+    /**
+     * Write the whole register image (PSC0 to LS3) in one burst, e.g. after
+     * the device was reset or a burst was interrupted
+     *
+     * @return true if the device acknowledged all bytes
+     */
+bool PCA9532::resync() {
+
+  return writeImage(REG_PSC0, REG_COUNT - REG_PSC0);
+}
+
+    /**
+     * Ideal bus cost model for a bus clock: one bit time for START and STOP,
+     * nine bit times per byte and the minimum bus free time after a STOP
+     *
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus profile
+     */
+PCA9532BusProfile PCA9532::busProfileForClock(uint32_t clockHz) {
+
+  uint32_t bitNanos = 1000000000UL / clockHz;
+  uint32_t idleNanos = clockHz <= 100000 ? BUS_FREE_NANOS_SM
+                     : clockHz <= 400000 ? BUS_FREE_NANOS_FM : BUS_FREE_NANOS_FMP;
+  PCA9532BusProfile profile = { bitNanos, 9 * bitNanos, bitNanos, idleNanos };
+
+  return profile;
+}
+
+    /**
+     * Set the bus cost model used for time estimates, e.g. a profile
+     * measured with extras/calibrate_bus.py (default: ideal 100kHz bus)
+     *
+     * @param profile Bus profile
+     */
+void PCA9532::setBusProfile(const PCA9532BusProfile &profile) {
+
+  _busProfile = profile;
+}
+
+    /**
+     * Get the bus cost model used for time estimates
+     *
+     * @return bus profile
+     */
+const PCA9532BusProfile &PCA9532::getBusProfile() const {
+
+  return _busProfile;
+}
+
+    /**
+     * Estimate the bus time for a number of transactions and bytes
+     *
+     * @param transactions Number of transactions (START to STOP)
+     * @param bytes        Number of bytes, address bytes included
+     *
+     * @return estimated bus time in microseconds
+     */
+uint32_t PCA9532::estimateBusMicros(uint32_t transactions, uint32_t bytes) const {
+
+  return estimateBusMicros(_busProfile, transactions, bytes);
+}
+
+    /**
+     * Estimate the bus time for a number of transactions and bytes with a
+     * given bus profile, e.g. for a fleet sharing one bus
+     *
+     * @param profile      Bus profile
+     * @param transactions Number of transactions (START to STOP)
+     * @param bytes        Number of bytes, address bytes included
+     *
+     * @return estimated bus time in microseconds
+     */
+uint32_t PCA9532::estimateBusMicros(const PCA9532BusProfile &profile,
+                                    uint32_t transactions, uint32_t bytes) {
+
+  uint64_t nanos = (uint64_t) transactions * (profile.startNanos + profile.stopNanos + profile.idleNanos)
+                 + (uint64_t) bytes * profile.byteNanos;
+
+  return (nanos + 999) / 1000;
+}
+
+    /**
+     * Dry run of flush(): cost of sending the pending register updates,
+     * nothing is sent
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+PCA9532BusCost PCA9532::estimateFlush() const {
+
+  return estimateRegisters(0);
+}
+
+    /**
+     * Dry run of writing a set of registers with queueReg() and flush(),
+     * in addition to the updates already pending
+     *
+     * @param registerMask Registers to write (bit n = register address n)
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+PCA9532BusCost PCA9532::estimateRegisters(uint16_t registerMask) const {
+
+  PCA9532BusCost cost = { 0, 0, 0 };
+  uint16_t writable = ((1 << REG_COUNT) - 1) & ~((1 << REG_PSC0) - 1);
+
+  // the lanes are flushed separately, a queued register keeps its lane
+  uint16_t high = _dirty[PRIORITY_HIGH];
+  uint16_t bulk = (_dirty[PRIORITY_BULK] | (registerMask & writable)) & ~high;
+
+  addBurstCost(high, REG_COUNT, cost);
+  addBurstCost(bulk, _maxBulkBurst, cost);
+
+  cost.micros = estimateBusMicros(cost.transactions, cost.bytes);
+
+  return cost;
+}
+
+    /**
+     * Dry run of bringing the device to a register image with queueReg()
+     * and flush(). Only registers that differ from the current image are
+     * counted, in addition to the updates already pending
+     *
+     * @param regImage Target register image (REG_COUNT bytes)
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+PCA9532BusCost PCA9532::estimateImage(const uint8_t *regImage) const {
+
+  uint16_t changed = 0;
+
+  for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+    if (regImage[r] != _regImage[r]) {
+      changed |= 1 << r;
+    }
+  }
+
+  return estimateRegisters(changed);
 }
 
 /****************************** PRIVATE METHODS *******************************/
@@ -175,10 +728,14 @@ void PCA9532::setLsStateAll(uint8_t state) {
     */
 void PCA9532::writeReg(uint8_t registerAddress, uint8_t data) {
 
-  _wire->beginTransmission(_deviceAddress);
-  _wire->write(registerAddress);
-  _wire->write(data);
-  _wire->endTransmission();
+  if (registerAddress >= REG_COUNT) {
+    writeBurst(registerAddress, &data, 1, 1);
+    return;
+  }
+
+  // a direct write supersedes a queued update of the same register
+  _regImage[registerAddress] = data;
+  writeDirect(registerAddress, 1);
 }
 
     /**
@@ -197,9 +754,189 @@ uint8_t PCA9532::readReg(uint8_t registerAddress) {
 
   _wire->requestFrom(_deviceAddress, (uint8_t) 1);
 
+  _busBytes += 4;
+  _busTransactions += 2;
+
   if (_wire->available() == 1) {
     return _wire->read();
   }
 
+  _busErrors++;
+
   return -1;
+}
+
+    /**
+    * Write consecutive registers in one transaction using auto-increment
+    *
+    * @param registerAddress First register address to write to
+    * @param data            Data to write
+    * @param length          Number of registers to write
+    * @param attempts        Number of attempts
+    *
+    * @return true if the device acknowledged all bytes
+    */
+bool PCA9532::writeBurst(uint8_t registerAddress, const uint8_t *data, uint8_t length,
+                         uint8_t attempts) {
+
+  for (uint8_t a = 0; a < attempts; a++) {
+
+    _wire->beginTransmission(_deviceAddress);
+    _wire->write(length > 1 ? AUTO_INCREMENT | registerAddress : registerAddress);
+    for (uint8_t i = 0; i < length; i++) {
+      _wire->write(data[i]);
+    }
+    uint8_t status = _wire->endTransmission();
+
+    _busBytes += 2 + length;
+    _busTransactions++;
+
+    if (status == 0) {
+      return true;
+    }
+  }
+
+  _busErrors++;
+
+  return false;
+}
+
+    /**
+    * Write consecutive registers from the register image in one transaction
+    * and clear their pending flags. Registers that could not be written are
+    * marked pending again
+    *
+    * @param registerAddress First register address to write to
+    * @param length          Number of registers to write
+    *
+    * @return true if the device acknowledged all bytes
+    */
+bool PCA9532::writeImage(uint8_t registerAddress, uint8_t length) {
+
+  uint16_t mask = ((1 << length) - 1) << registerAddress;
+  uint16_t high = _dirty[PRIORITY_HIGH] & mask;
+
+  for (uint8_t i = 0; i < PRIORITY_LANES; i++) {
+    _dirty[i] &= ~mask;
+  }
+
+  if (writeBurst(registerAddress, &_regImage[registerAddress], length,
+                 _deterministic ? 1 : 1 + _retries)) {
+    return true;
+  }
+
+  // the device may have taken part of the burst, resend all of it
+  _dirty[PRIORITY_HIGH] |= high;
+  _dirty[PRIORITY_BULK] |= mask & ~high;
+
+  return false;
+}
+
+    /**
+    * Write consecutive registers from the register image in one transaction
+    * on behalf of a direct call (setPwm() etc.) and clear their pending
+    * flags. The write is not retried, a failed write is counted but
+    * nothing is left pending
+    *
+    * @param registerAddress First register address to write to
+    * @param length          Number of registers to write
+    *
+    * @return true if the device acknowledged all bytes
+    */
+bool PCA9532::writeDirect(uint8_t registerAddress, uint8_t length) {
+
+  uint16_t mask = ((1 << length) - 1) << registerAddress;
+
+  for (uint8_t i = 0; i < PRIORITY_LANES; i++) {
+    _dirty[i] &= ~mask;
+  }
+
+  return writeBurst(registerAddress, &_regImage[registerAddress], length, 1);
+}
+
+    /**
+    * First run of consecutive registers in a set of pending registers, the
+    * burst flushStep() and flushAndReadInputs() send next
+    *
+    * @param dirty     Pending registers (bit n = register address n), not 0
+    * @param maxLength Longest run to return
+    * @param first     Set to the first register of the run
+    * @param length    Set to the number of registers in the run
+    */
+void PCA9532::findRun(uint16_t dirty, uint8_t maxLength, uint8_t &first, uint8_t &length) {
+
+  first = REG_PSC0;
+  while (!(dirty & (1 << first))) {
+    first++;
+  }
+  length = 1;
+  while (length < maxLength && first + length < REG_COUNT && (dirty & (1 << (first + length)))) {
+    length++;
+  }
+}
+
+    /**
+    * Add the transactions and bytes of sending the registers of a mask as
+    * bursts of consecutive registers, as flushStep() does
+    *
+    * @param registerMask Registers to send (bit n = register address n)
+    * @param maxLength    Longest burst
+    * @param cost         Cost to add to
+    */
+void PCA9532::addBurstCost(uint16_t registerMask, uint8_t maxLength, PCA9532BusCost &cost) {
+
+  uint8_t run = 0;
+
+  for (uint8_t r = 0; r < REG_COUNT; r++) {
+
+    if (!(registerMask & (1 << r))) {
+      run = 0;
+      continue;
+    }
+
+    // address and control byte once per burst of consecutive registers
+    if (run == 0 || run == maxLength) {
+      cost.transactions++;
+      cost.bytes += 2;
+      run = 0;
+    }
+    run++;
+    cost.bytes++;
+  }
+}
+
+    /**
+    * Read consecutive registers in one transaction using auto-increment
+    *
+    * @param registerAddress First register address to read from
+    * @param data            Buffer for the bytes read
+    * @param length          Number of registers to read
+    * @param repeatedStart   Read with a repeated START instead of STOP/START
+    *
+    * @return true if all bytes were read
+    */
+bool PCA9532::readBurst(uint8_t registerAddress, uint8_t *data, uint8_t length,
+                        bool repeatedStart) {
+
+  _wire->beginTransmission(_deviceAddress);
+  _wire->write(AUTO_INCREMENT | registerAddress);
+  _wire->endTransmission(!repeatedStart);
+
+  _wire->requestFrom(_deviceAddress, length);
+
+  _busBytes += 3 + length;
+  _busTransactions += repeatedStart ? 1 : 2;
+
+  if (_wire->available() != length) {
+    while (_wire->available()) {
+      _wire->read();
+    }
+    return false;
+  }
+
+  for (uint8_t i = 0; i < length; i++) {
+    data[i] = _wire->read();
+  }
+
+  return true;
 }
\ No newline at end of file
@@ -22,6 +22,10 @@
 #define REG_LS1    0x07 // LED4  to LED7 selector
 #define REG_LS2    0x08 // LED8  to LED11 selector
 #define REG_LS3    0x09 // LED12 to LED15 selector
+#define REG_COUNT  10   // Number of registers
+
+// Control register, auto-increment flag (page 6, figure 9)
+#define AUTO_INCREMENT 0x10 // Register address is incremented after each byte
 
 // Input register 0, INPUT0 (page 6, table 4)
 #define BIT_IN_LED7 128 // LED7 state
@@ -80,6 +84,58 @@
 #define LS_STATE_BLNK0 0x02 // Output blinks at PWM0 rate
 #define LS_STATE_BLNK1 0x03 // Output blinks at PWM1 rate
 
+// Upper bound of bus bytes (address and data) per call in deterministic mode
+#define DETERMINISTIC_MAX_BUS_BYTES 15
+
+// Default number of retries of a failed flush() burst
+#define BUS_RETRIES 2
+
+// Returned by nextDeadlineMicros() if no work is scheduled
+#define NO_DEADLINE 0xFFFFFFFFUL
+
+// Priority lanes for queued register updates
+#define PRIORITY_BULK  0 // Bulk traffic, e.g. animation frames (default)
+#define PRIORITY_HIGH  1 // Urgent traffic, e.g. alarm indicators
+#define PRIORITY_LANES 2 // Number of priority lanes
+
+// Bus free time between a STOP and the next START (I2C-bus specification)
+#define BUS_FREE_NANOS_SM  4700 // Standard-mode, up to 100kHz
+#define BUS_FREE_NANOS_FM  1300 // Fast-mode, up to 400kHz
+#define BUS_FREE_NANOS_FMP 500  // Fast-mode Plus, up to 1MHz
+
+/**
+ * Bus cost model, time per START, per byte (incl. ACK and inter-byte gap),
+ * per STOP and idle time from a STOP to the next START (bus free time plus
+ * the overhead of the Wire core). Measure it with extras/calibrate_bus.py
+ * or use PCA9532::busProfileForClock() for an ideal bus
+ */
+struct PCA9532BusProfile {
+    uint32_t startNanos;
+    uint32_t byteNanos;
+    uint32_t stopNanos;
+    uint32_t idleNanos;
+};
+
+/**
+ * Result of a dry run, see PCA9532::estimateFlush()
+ */
+struct PCA9532BusCost {
+    uint16_t transactions; // Transactions (START to STOP)
+    uint16_t bytes;        // Bytes, address bytes included
+    uint32_t micros;       // Estimated bus time with the current bus profile
+};
+
+/**
+ * Reflex table entry: if (inputs & inputMask) == inputValue, the output is
+ * set to the given state (see PCA9532::setReflexes())
+ */
+struct PCA9532Reflex {
+    uint16_t inputMask;  // Inputs to test (bit n = LEDn, INPUT1 in upper byte)
+    uint16_t inputValue; // Expected levels of the tested inputs
+    uint8_t output;      // Output LED0 to LED15 to set, others are ignored
+    uint8_t state;       // One of the four possible states
+};
+
 class PCA9532 {
 
 /******************************* PUBLIC METHODS *******************************/
@@ -163,6 +219,312 @@ public:
     */
     void setLsStateAll(uint8_t state);
 
+    /**
+     * LS register value with the state of one channel replaced. Pure
+     * function, no bus access
+     *
+     * @param regValue Current value of the LS register
+     * @param state    One of the four possible states
+     * @param lsBit    Lower bit of LS* (see BIT_LS_LED*)
+     *
+     * @return new LS register value
+     */
+    static uint8_t packLsState(uint8_t regValue, uint8_t state, uint8_t lsBit);
+
+    /**
+     * LS register value with all four channels in the same state. Pure
+     * function, no bus access
+     *
+     * @param state One of the four possible states
+     *
+     * @return LS register value
+     */
+    static uint8_t packLsStateAll(uint8_t state);
+
+    /**
+     * Register values after power-on, INPUT0 to LS3 (page 6, table 3)
+     */
+    static const uint8_t POWER_ON_REGS[REG_COUNT];
+
+    /**
+     * Queue a register write without touching the bus. The value is stored
+     * in the register image and sent by flush() or flushStep()
+     *
+     * A register queued on PRIORITY_HIGH is sent at the next transaction
+     * boundary, ahead of all registers pending on PRIORITY_BULK
+     *
+     * @param registerAddress Register address to write to
+     * @param data            Data to write
+     * @param priority        PRIORITY_BULK or PRIORITY_HIGH
+     */
+    void queueReg(uint8_t registerAddress, uint8_t data,
+                  uint8_t priority = PRIORITY_BULK);
+
+    /**
+     * Queue the LED output state for a given channel (see setLsState()).
+     * Modifies the register image only, no read before write is required
+     *
+     * @param state    One of the four possible states
+     * @param regLs    Register address of LS*
+     * @param lsBit    Lower bit of LS* (see BIT_LS_LED*)
+     * @param priority PRIORITY_BULK or PRIORITY_HIGH
+     */
+    void queueLsState(uint8_t state, uint8_t regLs, uint8_t lsBit,
+                      uint8_t priority = PRIORITY_BULK);
+
+    /**
+     * Send one transaction of pending register updates. High-priority
+     * registers are always sent first; bulk registers are sent as one burst
+     * of consecutive dirty registers per call, at most the length set with
+     * setMaxBulkBurst()
+     *
+     * @return true if a transaction was sent
+     * @return false if nothing was pending or the transaction failed
+     */
+    bool flushStep();
+
+    /**
+     * Send all pending register updates, one transaction at a time.
+     * Updates queued on PRIORITY_HIGH between two transactions overtake
+     * the remaining bulk bursts. Stops at the first failed transaction,
+     * the failed registers stay pending
+     */
+    void flush();
+
+    /**
+     * Check for pending register updates
+     *
+     * @param priority PRIORITY_BULK or PRIORITY_HIGH
+     *
+     * @return true if registers of the given lane are waiting to be sent
+     */
+    bool isPending(uint8_t priority) const;
+
+    /**
+     * Time until the driver needs to run again. Queued register updates
+     * are due immediately, otherwise the driver has nothing scheduled
+     *
+     * @return microseconds until flush() is due (0 = now)
+     * @return NO_DEADLINE if nothing is pending
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Get a register from the register image (no bus access)
+     *
+     * @param registerAddress Register address to get
+     *
+     * @return last value written or queued for the register
+     */
+    uint8_t getRegImage(uint8_t registerAddress) const;
+
+    /**
+     * Read the input registers INPUT0 and INPUT1, shared by all consumers.
+     * The cached inputs are returned if they are not older than maxAgeMicros,
+     * otherwise both registers are refreshed in one burst read. Each consumer
+     * passes its own freshness requirement, so the bus is polled only as often
+     * as the strictest consumer requires
+     *
+     * @param maxAgeMicros Maximum age of the cached inputs in microseconds
+     *                     (0 always reads from the device)
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+    uint16_t readInputs(uint32_t maxAgeMicros = 0);
+
+    /**
+     * Send all pending register updates and read INPUT0/INPUT1 in a single
+     * bus transaction: the bursts and the input read are chained with
+     * repeated STARTs and only the read ends with a STOP. The inputs are then
+     * evaluated against the reflex table, reflex outputs that change are
+     * sent at once on PRIORITY_HIGH
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+    uint16_t flushAndReadInputs();
+
+    /**
+     * Set the reflex table evaluated by flushAndReadInputs(). Entries are
+     * evaluated in order, a later matching entry overrides an earlier one
+     * for the same output. Entries with an output above LED15 are ignored
+     *
+     * @param reflexes Reflex table, must stay valid while in use (NULL = none)
+     * @param count    Number of entries
+     */
+    void setReflexes(const PCA9532Reflex *reflexes, uint8_t count);
+
+    /**
+     * Enable or disable deterministic-timing mode. In this mode every public
+     * call is served from the register image, never reads before writing,
+     * never retries and sends a bounded number of bus bytes (address bytes
+     * included), whatever the state of the bus or the pending updates:
+     *
+     *   - turnOn(), turnOff(), setLsStateAll()     6 bytes, 1 transaction
+     *   - setGrpPwm()                              5 bytes, 1 transaction
+     *   - setPwm(), setBlinking(), setLsState()    3 bytes, 1 transaction
+     *   - flushStep(), flush()             at most 10 bytes, 1 transaction
+     *   - resync()                                10 bytes, 1 transaction
+     *   - readInputs()                     at most  5 bytes, 2 transactions
+     *   - flushAndReadInputs()             at most 15 bytes, 3 transactions
+     *
+     * flush() sends a single burst per call like flushStep(), call it until
+     * isPending() is false. flushAndReadInputs() chains at most one burst
+     * with the input read, reflex outputs are queued on PRIORITY_HIGH and
+     * sent by the next call. A failed direct write is counted in
+     * getBusErrors() and not sent again, resync() restores the device
+     *
+     * The worst case execution time of a call is therefore bounded by
+     * DETERMINISTIC_MAX_BUS_BYTES * 9 bit times plus START/STOP conditions,
+     * i.e. about 1.4ms at 100kHz and 0.35ms at 400kHz, provided the Wire
+     * core is configured with a timeout (e.g. Wire.setWireTimeout() on AVR).
+     *
+     * Enabling the mode reads PSC0 to LS3 once in a single burst (11 bytes)
+     * to make the register image match the device. Registers queued but not
+     * sent yet keep their queued value and stay pending
+     *
+     * @param enable true to enable deterministic-timing mode
+     *
+     * @return true if the mode is enabled as requested
+     * @return false if the register image could not be read, the mode
+     *         stays disabled
+     */
+    bool setDeterministic(bool enable);
+
+    /**
+     * Number of bytes sent or received on the bus since the last
+     * resetBusStats(), address bytes included
+     *
+     * @return bus bytes
+     */
+    uint32_t getBusBytes() const;
+
+    /**
+     * Number of transactions (START to STOP) since the last resetBusStats()
+     *
+     * @return bus transactions
+     */
+    uint32_t getBusTransactions() const;
+
+    /**
+     * Reset the bus statistics
+     */
+    void resetBusStats();
+
+    /**
+     * Set the number of retries of a failed burst sent by flush(),
+     * flushStep() or resync() (default BUS_RETRIES). Registers whose write
+     * still fails stay pending and are sent again by the next flush().
+     * Direct writes such as setPwm() make a single attempt, and there are
+     * no retries in deterministic mode
+     *
+     * @param retries Number of retries
+     */
+    void setRetries(uint8_t retries);
+
+    /**
+     * Set the longest burst flushStep() and flush() send from PRIORITY_BULK.
+     * A register queued on PRIORITY_HIGH waits for at most one bulk burst,
+     * so this bounds its latency, e.g. 4 registers keep it under 1ms at
+     * 100kHz. Longer runs of pending bulk registers are split (default
+     * REG_COUNT, no limit)
+     *
+     * @param registers Registers per bulk burst (at least 1)
+     */
+    void setMaxBulkBurst(uint8_t registers);
+
+    /**
+     * Number of transactions that failed after all retries since the last
+     * resetBusStats()
+     *
+     * @return bus errors
+     */
+    uint32_t getBusErrors() const;
+
+    /**
+     * Write the whole register image (PSC0 to LS3) in one burst, e.g. after
+     * the device was reset or a burst was interrupted
+     *
+     * @return true if the device acknowledged all bytes
+     */
+    bool resync();
+
+    /**
+     * Ideal bus cost model for a bus clock: one bit time for START and STOP,
+     * nine bit times per byte and the minimum bus free time after a STOP
+     *
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus profile
+     */
+    static PCA9532BusProfile busProfileForClock(uint32_t clockHz);
+
+    /**
+     * Set the bus cost model used for time estimates, e.g. a profile
+     * measured with extras/calibrate_bus.py (default: ideal 100kHz bus)
+     *
+     * @param profile Bus profile
+     */
+    void setBusProfile(const PCA9532BusProfile &profile);
+
+    /**
+     * Get the bus cost model used for time estimates
+     *
+     * @return bus profile
+     */
+    const PCA9532BusProfile &getBusProfile() const;
+
+    /**
+     * Estimate the bus time for a number of transactions and bytes
+     *
+     * @param transactions Number of transactions (START to STOP)
+     * @param bytes        Number of bytes, address bytes included
+     *
+     * @return estimated bus time in microseconds
+     */
+    uint32_t estimateBusMicros(uint32_t transactions, uint32_t bytes) const;
+
+    /**
+     * Estimate the bus time for a number of transactions and bytes with a
+     * given bus profile, e.g. for a fleet sharing one bus
+     *
+     * @param profile      Bus profile
+     * @param transactions Number of transactions (START to STOP)
+     * @param bytes        Number of bytes, address bytes included
+     *
+     * @return estimated bus time in microseconds
+     */
+    static uint32_t estimateBusMicros(const PCA9532BusProfile &profile,
+                                      uint32_t transactions, uint32_t bytes);
+
+    /**
+     * Dry run of flush(): cost of sending the pending register updates,
+     * nothing is sent
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+    PCA9532BusCost estimateFlush() const;
+
+    /**
+     * Dry run of writing a set of registers with queueReg() and flush(),
+     * in addition to the updates already pending
+     *
+     * @param registerMask Registers to write (bit n = register address n)
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+    PCA9532BusCost estimateRegisters(uint16_t registerMask) const;
+
+    /**
+     * Dry run of bringing the device to a register image with queueReg()
+     * and flush(). Only registers that differ from the current image are
+     * counted, in addition to the updates already pending
+     *
+     * @param regImage Target register image (REG_COUNT bytes)
+     *
+     * @return transactions, bytes and estimated bus time
+     */
+    PCA9532BusCost estimateImage(const uint8_t *regImage) const;
+
 /****************************** PRIVATE METHODS *******************************/
 private:
 
@@ -180,6 +542,56 @@ private:
     uint8_t _storedRegLs2;
     uint8_t _storedRegLs3;
 
+    /**
+     * Register image of the device, updated on every write and queue
+     */
+    uint8_t _regImage[REG_COUNT];
+
+    /**
+     * Pending registers per priority lane, one bit per register address
+     */
+    uint16_t _dirty[PRIORITY_LANES];
+
+    /**
+     * Cached input registers and the time they were read (see readInputs())
+     */
+    uint16_t _inputs;
+    uint32_t _inputsMicros;
+    bool _inputsValid;
+
+    /**
+     * Reflex table (see setReflexes())
+     */
+    const PCA9532Reflex *_reflexes;
+    uint8_t _reflexCount;
+
+    /**
+     * Deterministic-timing mode (see setDeterministic())
+     */
+    bool _deterministic;
+
+    /**
+     * Bus statistics (see getBusBytes())
+     */
+    uint32_t _busBytes;
+    uint32_t _busTransactions;
+    uint32_t _busErrors;
+
+    /**
+     * Number of retries of a failed transaction (see setRetries())
+     */
+    uint8_t _retries;
+
+    /**
+     * Longest burst from PRIORITY_BULK (see setMaxBulkBurst())
+     */
+    uint8_t _maxBulkBurst;
+
+    /**
+     * Bus cost model (see setBusProfile())
+     */
+    PCA9532BusProfile _busProfile;
+
     /**
     * Write data to a register
     *
@@ -198,6 +610,78 @@ private:
     */
     uint8_t readReg(uint8_t registerAddress);
 
+    /**
+    * Write consecutive registers in one transaction using auto-increment
+    *
+    * @param registerAddress First register address to write to
+    * @param data            Data to write
+    * @param length          Number of registers to write
+    * @param attempts        Number of attempts
+    *
+    * @return true if the device acknowledged all bytes
+    */
+    bool writeBurst(uint8_t registerAddress, const uint8_t *data, uint8_t length,
+                    uint8_t attempts);
+
+    /**
+    * Write consecutive registers from the register image in one transaction
+    * and clear their pending flags. Registers that could not be written are
+    * marked pending again
+    *
+    * @param registerAddress First register address to write to
+    * @param length          Number of registers to write
+    *
+    * @return true if the device acknowledged all bytes
+    */
+    bool writeImage(uint8_t registerAddress, uint8_t length);
+
+    /**
+    * Write consecutive registers from the register image in one transaction
+    * on behalf of a direct call (setPwm() etc.) and clear their pending
+    * flags. The write is not retried, a failed write is counted but
+    * nothing is left pending
+    *
+    * @param registerAddress First register address to write to
+    * @param length          Number of registers to write
+    *
+    * @return true if the device acknowledged all bytes
+    */
+    bool writeDirect(uint8_t registerAddress, uint8_t length);
+
+    /**
+    * First run of consecutive registers in a set of pending registers, the
+    * burst flushStep() and flushAndReadInputs() send next
+    *
+    * @param dirty     Pending registers (bit n = register address n), not 0
+    * @param maxLength Longest run to return
+    * @param first     Set to the first register of the run
+    * @param length    Set to the number of registers in the run
+    */
+    static void findRun(uint16_t dirty, uint8_t maxLength, uint8_t &first, uint8_t &length);
+
+    /**
+    * Add the transactions and bytes of sending the registers of a mask as
+    * bursts of consecutive registers, as flushStep() does
+    *
+    * @param registerMask Registers to send (bit n = register address n)
+    * @param maxLength    Longest burst
+    * @param cost         Cost to add to
+    */
+    static void addBurstCost(uint16_t registerMask, uint8_t maxLength, PCA9532BusCost &cost);
+
+    /**
+    * Read consecutive registers in one transaction using auto-increment
+    *
+    * @param registerAddress First register address to read from
+    * @param data            Buffer for the bytes read
+    * @param length          Number of registers to read
+    * @param repeatedStart   Read with a repeated START instead of STOP/START
+    *
+    * @return true if all bytes were read
+    */
+    bool readBurst(uint8_t registerAddress, uint8_t *data, uint8_t length,
+                   bool repeatedStart = false);
+
     /**
      * I2C address of device.
      */
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Aligner.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for PWM-cycle-aligned writes. Pending register updates are
+     * sent right after a blink period boundary, so a change of PWM or LS
+     * never cuts a period in two. The timebase of each blink channel is
+     * calibrated from the device's own INPUT register, or follows the
+     * nominal 152Hz model from a known start (see setTimebase())
+     *
+     * @param device PCA9532 to write to
+     */
+PCA9532Aligner::PCA9532Aligner(PCA9532 *device) {
+
+  _device = device;
+  for (uint8_t c = 0; c < 2; c++) {
+    _origin[c] = 0;
+    _calPeriod[c] = 0;
+    _calPsc[c] = 0;
+    _calibrated[c] = false;
+  }
+  _timebase = 0;
+  _hasTimebase = false;
+  _maxWait = ALIGN_MAX_WAIT_MICROS;
+}
+
+    /**
+     * Calibrate the timebase of a blink channel from a blinking output. The
+     * output must be set to LS_STATE_BLNK0 or LS_STATE_BLNK1 and be read
+     * back through INPUT0/INPUT1 (an LED turning on pulls its pin LOW). The
+     * start of the first and of the last of a number of consecutive periods
+     * is measured, giving the phase and the real period. The error of
+     * sampling the input over the bus, about one input read, is spread
+     * across all periods. It still adds up with every period after the
+     * calibration, calibrate again from time to time
+     *
+     * @param output        Blinking output LED0 to LED15
+     * @param timeoutMicros Maximum time to wait, at least periods + 1 blink
+     *                      periods
+     * @param periods       Number of periods to measure
+     *
+     * @return true if the channel the output blinks on was calibrated
+     */
+bool PCA9532Aligner::calibrate(uint8_t output, uint32_t timeoutMicros, uint8_t periods) {
+
+  uint8_t regLs = REG_LS0 + (output >> 2);
+  uint8_t state = (_device->getRegImage(regLs) >> ((output & 3) << 1)) & 0b11;
+
+  if (periods == 0 || (state != LS_STATE_BLNK0 && state != LS_STATE_BLNK1)) {
+    return false;
+  }
+
+  uint8_t channel = state == LS_STATE_BLNK1 ? 1 : 0;
+  uint16_t bit = 1 << output;
+  uint32_t deadline = micros() + timeoutMicros;
+  uint32_t first, last;
+
+  if (!waitPeriodStart(bit, deadline, first)) {
+    return false;
+  }
+  last = first;
+  for (uint8_t p = 0; p < periods; p++) {
+    if (!waitPeriodStart(bit, deadline, last)) {
+      return false;
+    }
+  }
+
+  _calPsc[channel] = _device->getRegImage(channel ? REG_PSC1 : REG_PSC0);
+  _calPeriod[channel] = (uint64_t) (last - first) * 1000 / periods;
+  _origin[channel] = last;
+  _calibrated[channel] = true;
+
+  return true;
+}
+
+    /**
+     * Set the time the blink timebase of the device started, e.g. right
+     * after power-on. Channels that are not calibrated follow the nominal
+     * period from this time on (see PCA9532Panel::blinkPeriodMicros())
+     *
+     * @param originMicros micros() at the start of the timebase
+     */
+void PCA9532Aligner::setTimebase(uint32_t originMicros) {
+
+  _timebase = originMicros;
+  _hasTimebase = true;
+}
+
+    /**
+     * Set the maximum time flushAligned() waits for a period boundary
+     *
+     * @param maxWaitMicros Maximum wait in microseconds
+     */
+void PCA9532Aligner::setMaxWait(uint32_t maxWaitMicros) {
+
+  _maxWait = maxWaitMicros;
+}
+
+    /**
+     * Time until the next period boundary of a blink channel
+     *
+     * @param regPsc REG_PSC0 or REG_PSC1
+     *
+     * @return microseconds until the next period starts, 0 if the channel
+     *         has no timebase
+     */
+uint32_t PCA9532Aligner::untilBoundaryMicros(uint8_t regPsc) const {
+
+  uint8_t channel = regPsc == REG_PSC1 ? 1 : 0;
+
+  if (!_calibrated[channel] && !_hasTimebase) {
+    return 0;
+  }
+
+  uint32_t origin = _calibrated[channel] ? _origin[channel] : _timebase;
+  uint32_t period = periodNanos(channel);
+  uint32_t phase = (uint64_t) (micros() - origin) * 1000 % period;
+
+  // round up, the write must not land before the boundary
+  return (period - phase + 999) / 1000;
+}
+
+    /**
+     * Send the pending register updates right after the next period
+     * boundary of a blink channel. Uncalibrated channels use the nominal
+     * model from setTimebase(). If the boundary is further away than the
+     * latency budget or the maximum wait, or the channel has neither, the
+     * updates are sent immediately
+     *
+     * @param regPsc       Channel the updates affect, REG_PSC0 or REG_PSC1
+     * @param budgetMicros Latency the caller can accept
+     *
+     * @return true if the updates were aligned to a period boundary
+     */
+bool PCA9532Aligner::flushAligned(uint8_t regPsc, uint32_t budgetMicros) {
+
+  uint8_t channel = regPsc == REG_PSC1 ? 1 : 0;
+
+  if (!_calibrated[channel] && !_hasTimebase) {
+    _device->flush();
+    return false;
+  }
+
+  uint32_t wait = untilBoundaryMicros(regPsc);
+
+  if (wait > budgetMicros || wait > _maxWait) {
+    _device->flush();
+    return false;
+  }
+
+  // delayMicroseconds() takes 16 bits on some cores
+  delay(wait / 1000);
+  delayMicroseconds(wait % 1000);
+
+  _device->flush();
+
+  return true;
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Wait for the input of an output to go LOW (period start)
+     *
+     * @param bit      Input bit of the output
+     * @param deadline Time to give up
+     * @param start    Time the period started
+     *
+     * @return false on timeout
+     */
+bool PCA9532Aligner::waitPeriodStart(uint16_t bit, uint32_t deadline, uint32_t &start) {
+
+  bool wasOff = false;
+  uint32_t previous = 0;
+
+  while ((int32_t) (deadline - micros()) > 0) {
+
+    uint32_t before = micros();
+    bool off = _device->readInputs(0) & bit;
+    uint32_t sample = before + (micros() - before) / 2;
+
+    if (wasOff && !off) {
+      // the edge happened between the two samples, take the middle
+      start = previous + (sample - previous) / 2;
+      return true;
+    }
+    wasOff = off;
+    previous = sample;
+  }
+
+  return false;
+}
+
+    /**
+     * Real blink period of a channel, scaled from the calibration or the
+     * nominal period
+     *
+     * @param channel 0 for PSC0/PWM0, 1 for PSC1/PWM1
+     *
+     * @return period in nanoseconds
+     */
+uint32_t PCA9532Aligner::periodNanos(uint8_t channel) const {
+
+  uint8_t psc = _device->getRegImage(channel ? REG_PSC1 : REG_PSC0);
+
+  if (!_calibrated[channel]) {
+    return PCA9532Panel::blinkPeriodMicros(psc) * 1000;
+  }
+
+  return (uint64_t) _calPeriod[channel] * (psc + 1) / (_calPsc[channel] + 1);
+}
\ No newline at end of file
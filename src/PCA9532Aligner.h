@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532ALIGNER_H
+#define PCA9532ALIGNER_H
+
+#include "PCA9532Panel.h"
+
+// Default maximum wait for a period boundary
+#define ALIGN_MAX_WAIT_MICROS 2000
+
+// Default number of blink periods measured by calibrate()
+#define ALIGN_CAL_PERIODS 16
+
+class PCA9532Aligner {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for PWM-cycle-aligned writes. Pending register updates are
+     * sent right after a blink period boundary, so a change of PWM or LS
+     * never cuts a period in two. The timebase of each blink channel is
+     * calibrated from the device's own INPUT register, or follows the
+     * nominal 152Hz model from a known start (see setTimebase())
+     *
+     * @param device PCA9532 to write to
+     */
+    PCA9532Aligner(PCA9532 *device);
+
+    /**
+     * Calibrate the timebase of a blink channel from a blinking output. The
+     * output must be set to LS_STATE_BLNK0 or LS_STATE_BLNK1 and be read
+     * back through INPUT0/INPUT1 (an LED turning on pulls its pin LOW). The
+     * start of the first and of the last of a number of consecutive periods
+     * is measured, giving the phase and the real period. The error of
+     * sampling the input over the bus, about one input read, is spread
+     * across all periods. It still adds up with every period after the
+     * calibration, calibrate again from time to time
+     *
+     * @param output        Blinking output LED0 to LED15
+     * @param timeoutMicros Maximum time to wait, at least periods + 1 blink
+     *                      periods
+     * @param periods       Number of periods to measure
+     *
+     * @return true if the channel the output blinks on was calibrated
+     */
+    bool calibrate(uint8_t output, uint32_t timeoutMicros, uint8_t periods = ALIGN_CAL_PERIODS);
+
+    /**
+     * Set the time the blink timebase of the device started, e.g. right
+     * after power-on. Channels that are not calibrated follow the nominal
+     * period from this time on (see PCA9532Panel::blinkPeriodMicros())
+     *
+     * @param originMicros micros() at the start of the timebase
+     */
+    void setTimebase(uint32_t originMicros);
+
+    /**
+     * Set the maximum time flushAligned() waits for a period boundary
+     *
+     * @param maxWaitMicros Maximum wait in microseconds
+     */
+    void setMaxWait(uint32_t maxWaitMicros);
+
+    /**
+     * Time until the next period boundary of a blink channel
+     *
+     * @param regPsc REG_PSC0 or REG_PSC1
+     *
+     * @return microseconds until the next period starts, 0 if the channel
+     *         has no timebase
+     */
+    uint32_t untilBoundaryMicros(uint8_t regPsc) const;
+
+    /**
+     * Send the pending register updates right after the next period
+     * boundary of a blink channel. Uncalibrated channels use the nominal
+     * model from setTimebase(). If the boundary is further away than the
+     * latency budget or the maximum wait, or the channel has neither, the
+     * updates are sent immediately
+     *
+     * @param regPsc       Channel the updates affect, REG_PSC0 or REG_PSC1
+     * @param budgetMicros Latency the caller can accept
+     *
+     * @return true if the updates were aligned to a period boundary
+     */
+    bool flushAligned(uint8_t regPsc, uint32_t budgetMicros);
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Wait for the input of an output to go LOW (period start)
+     *
+     * @param bit      Input bit of the output
+     * @param deadline Time to give up
+     * @param start    Time the period started
+     *
+     * @return false on timeout
+     */
+    bool waitPeriodStart(uint16_t bit, uint32_t deadline, uint32_t &start);
+
+    /**
+     * Real blink period of a channel, scaled from the calibration or the
+     * nominal period
+     *
+     * @param channel 0 for PSC0/PWM0, 1 for PSC1/PWM1
+     *
+     * @return period in nanoseconds
+     */
+    uint32_t periodNanos(uint8_t channel) const;
+
+    /**
+     * PCA9532 to write to
+     */
+    PCA9532 *_device;
+
+    /**
+     * Calibration per blink channel: start of a period, real period in
+     * nanoseconds and the PSC value it was measured at
+     */
+    uint32_t _origin[2];
+    uint32_t _calPeriod[2];
+    uint8_t _calPsc[2];
+    bool _calibrated[2];
+
+    /**
+     * Start of the nominal timebase (see setTimebase())
+     */
+    uint32_t _timebase;
+    bool _hasTimebase;
+
+    /**
+     * Maximum wait for a period boundary
+     */
+    uint32_t _maxWait;
+};
+#endif //PCA9532ALIGNER_H
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532BUDGET_H
+#define PCA9532BUDGET_H
+
+#include "PCA9532.h"
+
+/**
+ * Compile-time bus cost of scenes and effects. A scene is a constexpr array
+ * of register images (REG_COUNT bytes each), one per frame. Frame n costs
+ * the bursts of consecutive registers that differ from frame n - 1, as sent
+ * by PCA9532::flush(); frame 0 writes PSC0 to LS3 in one burst. Times use
+ * a bus profile, either the ideal one for a bus clock (see
+ * PCA9532::busProfileForClock()) or a constexpr profile measured with
+ * extras/calibrate_bus.py.
+ *
+ * Example:
+ *
+ *   constexpr uint8_t scene[][REG_COUNT] = { ... };
+ *   PCA9532_ASSERT_BUDGET(scene, 400000, 60);
+ *
+ *   constexpr PCA9532BusProfile measured = { 2600, 23100, 2700, 9800 };
+ *   PCA9532_ASSERT_BUDGET(scene, measured, 60);
+ *
+ * Every frame is evaluated once and the recursion over the frames only
+ * goes log2(frames) deep, scenes of thousands of frames compile quickly.
+ */
+struct PCA9532Budget {
+
+    /**
+     * Number of transactions to send the registers of a mask
+     *
+     * @param mask Registers to send (bit n = register address n)
+     * @param r    First register to look at (recursion)
+     *
+     * @return transactions
+     */
+    static constexpr uint8_t transactions(uint16_t mask, uint8_t r = 0) {
+        return r >= REG_COUNT ? 0
+             : (((mask >> r) & 1) && (r == 0 || !((mask >> (r - 1)) & 1)) ? 1 : 0)
+               + transactions(mask, r + 1);
+    }
+
+    /**
+     * Number of bytes to send the registers of a mask, address and control
+     * bytes included
+     *
+     * @param mask Registers to send (bit n = register address n)
+     * @param r    First register to look at (recursion)
+     *
+     * @return bytes
+     */
+    static constexpr uint8_t bytes(uint16_t mask, uint8_t r = 0) {
+        return r >= REG_COUNT ? 0
+             : ((mask >> r) & 1) + bytes(mask, r + 1) + (r == 0 ? 2 * transactions(mask) : 0);
+    }
+
+    /**
+     * Ideal bus profile for a bus clock, the same as
+     * PCA9532::busProfileForClock() but usable in constant expressions
+     *
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus profile
+     */
+    static constexpr PCA9532BusProfile profileForClock(uint32_t clockHz) {
+        return PCA9532BusProfile { (uint32_t) (1000000000UL / clockHz),
+                                   (uint32_t) (9 * (1000000000UL / clockHz)),
+                                   (uint32_t) (1000000000UL / clockHz),
+                                   (uint32_t) (clockHz <= 100000 ? BUS_FREE_NANOS_SM
+                                             : clockHz <= 400000 ? BUS_FREE_NANOS_FM : BUS_FREE_NANOS_FMP) };
+    }
+
+    /**
+     * Bus time for the registers of a mask
+     *
+     * @param mask    Registers to send (bit n = register address n)
+     * @param profile Bus profile
+     *
+     * @return bus time in nanoseconds
+     */
+    static constexpr uint32_t nanos(uint16_t mask, const PCA9532BusProfile &profile) {
+        return transactions(mask) * (profile.startNanos + profile.stopNanos + profile.idleNanos)
+             + bytes(mask) * profile.byteNanos;
+    }
+
+    /**
+     * Bus time for the registers of a mask
+     *
+     * @param mask    Registers to send (bit n = register address n)
+     * @param profile Bus profile
+     *
+     * @return bus time in microseconds, rounded up
+     */
+    static constexpr uint32_t micros(uint16_t mask, const PCA9532BusProfile &profile) {
+        return (nanos(mask, profile) + 999) / 1000;
+    }
+
+    /**
+     * Bus time for the registers of a mask on an ideal bus
+     *
+     * @param mask    Registers to send (bit n = register address n)
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus time in microseconds, rounded up
+     */
+    static constexpr uint32_t micros(uint16_t mask, uint32_t clockHz) {
+        return micros(mask, profileForClock(clockHz));
+    }
+
+    /**
+     * Registers that differ between two frames of a scene
+     *
+     * @param frames Scene
+     * @param n      Frame to compare with frame n - 1 (n > 0)
+     * @param r      First register to look at (recursion)
+     *
+     * @return changed registers (bit n = register address n)
+     */
+    static constexpr uint16_t changed(const uint8_t (*frames)[REG_COUNT], uint16_t n, uint8_t r = REG_PSC0) {
+        return r >= REG_COUNT ? 0
+             : (frames[n][r] != frames[n - 1][r] ? 1 << r : 0) | changed(frames, n, r + 1);
+    }
+
+    /**
+     * Registers sent for a frame of a scene
+     *
+     * @param frames Scene
+     * @param n      Frame
+     *
+     * @return registers to send (bit n = register address n)
+     */
+    static constexpr uint16_t frameMask(const uint8_t (*frames)[REG_COUNT], uint16_t n) {
+        return n == 0 ? ((1 << REG_COUNT) - 1) & ~((1 << REG_PSC0) - 1) : changed(frames, n);
+    }
+
+    /**
+     * Larger of two values
+     *
+     * @param a First value
+     * @param b Second value
+     *
+     * @return the larger value
+     */
+    static constexpr uint32_t max2(uint32_t a, uint32_t b) {
+        return a > b ? a : b;
+    }
+
+    /**
+     * Bus time of the most expensive frame in a range of frames. The range
+     * is split in halves, so the recursion depth grows with log2 of the
+     * number of frames and every frame is evaluated once
+     *
+     * @param frames  Scene
+     * @param first   First frame of the range
+     * @param last    End of the range (exclusive)
+     * @param profile Bus profile
+     *
+     * @return bus time in microseconds
+     */
+    static constexpr uint32_t maxRangeMicros(const uint8_t (*frames)[REG_COUNT], uint16_t first,
+                                             uint16_t last, const PCA9532BusProfile &profile) {
+        return last <= first ? 0
+             : last - first == 1 ? micros(frameMask(frames, first), profile)
+             : max2(maxRangeMicros(frames, first, first + (last - first) / 2, profile),
+                    maxRangeMicros(frames, first + (last - first) / 2, last, profile));
+    }
+
+    /**
+     * Bus time of the most expensive frame of a scene
+     *
+     * @param frames  Scene
+     * @param count   Number of frames
+     * @param profile Bus profile
+     *
+     * @return bus time in microseconds
+     */
+    static constexpr uint32_t maxFrameMicros(const uint8_t (*frames)[REG_COUNT], uint16_t count,
+                                             const PCA9532BusProfile &profile) {
+        return maxRangeMicros(frames, 0, count, profile);
+    }
+
+    /**
+     * Bus time of the most expensive frame of a scene on an ideal bus
+     *
+     * @param frames  Scene
+     * @param count   Number of frames
+     * @param clockHz I2C bus clock in Hz
+     *
+     * @return bus time in microseconds
+     */
+    static constexpr uint32_t maxFrameMicros(const uint8_t (*frames)[REG_COUNT], uint16_t count,
+                                             uint32_t clockHz) {
+        return maxFrameMicros(frames, count, profileForClock(clockHz));
+    }
+
+    /**
+     * Check that every frame of a scene fits into the frame period
+     *
+     * @param frames  Scene
+     * @param count   Number of frames
+     * @param profile Bus profile
+     * @param fps     Frame rate
+     *
+     * @return true if the scene fits the bus budget
+     */
+    static constexpr bool fits(const uint8_t (*frames)[REG_COUNT], uint16_t count,
+                               const PCA9532BusProfile &profile, uint16_t fps) {
+        return maxFrameMicros(frames, count, profile) <= 1000000UL / fps;
+    }
+
+    /**
+     * Check that every frame of a scene fits into the frame period on an
+     * ideal bus
+     *
+     * @param frames  Scene
+     * @param count   Number of frames
+     * @param clockHz I2C bus clock in Hz
+     * @param fps     Frame rate
+     *
+     * @return true if the scene fits the bus budget
+     */
+    static constexpr bool fits(const uint8_t (*frames)[REG_COUNT], uint16_t count,
+                               uint32_t clockHz, uint16_t fps) {
+        return fits(frames, count, profileForClock(clockHz), fps);
+    }
+};
+
+// Fail the build if a constexpr scene does not fit the bus budget, for a bus
+// clock in Hz or a constexpr PCA9532BusProfile
+#define PCA9532_ASSERT_BUDGET(frames, clockHzOrProfile, fps) \
+    static_assert(PCA9532Budget::fits(frames, sizeof(frames) / sizeof(frames[0]), clockHzOrProfile, fps), \
+                  "PCA9532 scene " #frames " exceeds the bus budget")
+
+// LS0 to LS3 in one burst: 1 transaction, 6 bytes
+static_assert(PCA9532Budget::transactions(0x3C0) == 1 && PCA9532Budget::bytes(0x3C0) == 6,
+              "PCA9532Budget burst model");
+
+#endif //PCA9532BUDGET_H
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Canvas.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a 2D canvas over a fleet of PCA9532. Pixel values are
+     * LED output states (LS_STATE_*). Drawing only modifies the register
+     * images of the fleet, flush() sends them in one burst per device
+     *
+     * @param fleet  Fleet holding the devices of the panel
+     * @param layout Layout table, width * height entries in row-major order
+     * @param width  Width of the canvas in pixels
+     * @param height Height of the canvas in pixels
+     */
+PCA9532Canvas::PCA9532Canvas(PCA9532Fleet *fleet, const PCA9532Pixel *layout,
+                             uint8_t width, uint8_t height) {
+
+  _fleet = fleet;
+  _layout = layout;
+  _width = width;
+  _height = height;
+}
+
+    /**
+     * Fill a layout table for a serpentine wired panel: even rows run left
+     * to right, odd rows right to left, devices are chained with 16 outputs
+     * each. Outputs listed in skipMask are not connected and are skipped
+     *
+     * @param layout      Layout table to fill, width * height entries
+     * @param width       Width of the panel in pixels
+     * @param height      Height of the panel in pixels
+     * @param firstDevice Index of the first device in the fleet
+     * @param skipMask    Unconnected outputs of every device (bit n = LEDn)
+     *
+     * @return number of pixels mapped, 0 if skipMask leaves no output (all
+     *         pixels are set to CANVAS_NO_OUTPUT)
+     */
+uint16_t PCA9532Canvas::buildSerpentine(PCA9532Pixel *layout, uint8_t width, uint8_t height,
+                                        uint8_t firstDevice, uint16_t skipMask) {
+
+  uint8_t device = firstDevice;
+  uint8_t output = 0;
+
+  if (skipMask == 0xFFFF) {
+    // no output left to map to
+    for (uint16_t i = 0; i < (uint16_t) width * height; i++) {
+      layout[i].device = firstDevice;
+      layout[i].output = CANVAS_NO_OUTPUT;
+    }
+    return 0;
+  }
+
+  for (uint8_t y = 0; y < height; y++) {
+    for (uint8_t i = 0; i < width; i++) {
+
+      uint8_t x = (y & 1) ? width - 1 - i : i;
+
+      while (skipMask & (1 << output)) {
+        if (++output == 16) {
+          output = 0;
+          device++;
+        }
+      }
+
+      layout[y * width + x].device = device;
+      layout[y * width + x].output = output;
+
+      if (++output == 16) {
+        output = 0;
+        device++;
+      }
+    }
+  }
+
+  return (uint16_t) width * height;
+}
+
+    /**
+     * Set a pixel, pixels outside the canvas are ignored
+     *
+     * @param x     Column
+     * @param y     Row
+     * @param state One of the four possible states
+     */
+void PCA9532Canvas::setPixel(int16_t x, int16_t y, uint8_t state) {
+
+  if (x < 0 || y < 0 || x >= _width || y >= _height) {
+    return;
+  }
+
+  const PCA9532Pixel &pixel = _layout[y * _width + x];
+
+  if (pixel.output == CANVAS_NO_OUTPUT) {
+    return;
+  }
+
+  _fleet->setLsState(pixel.device, state, REG_LS0 + (pixel.output >> 2), (pixel.output & 3) << 1);
+}
+
+    /**
+     * Draw a line (Bresenham)
+     *
+     * @param x0    Column of the start point
+     * @param y0    Row of the start point
+     * @param x1    Column of the end point
+     * @param y1    Row of the end point
+     * @param state One of the four possible states
+     */
+void PCA9532Canvas::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t state) {
+
+  int16_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  int16_t dy = y1 > y0 ? y0 - y1 : y1 - y0;
+  int8_t sx = x0 < x1 ? 1 : -1;
+  int8_t sy = y0 < y1 ? 1 : -1;
+  int16_t err = dx + dy;
+
+  for (;;) {
+    setPixel(x0, y0, state);
+
+    if (x0 == x1 && y0 == y1) {
+      break;
+    }
+
+    int16_t e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+    /**
+     * Draw the outline of a rectangle
+     *
+     * @param x      Left column
+     * @param y      Top row
+     * @param width  Width in pixels
+     * @param height Height in pixels
+     * @param state  One of the four possible states
+     */
+void PCA9532Canvas::rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t state) {
+
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  line(x, y, x + width - 1, y, state);
+  line(x, y + height - 1, x + width - 1, y + height - 1, state);
+  line(x, y, x, y + height - 1, state);
+  line(x + width - 1, y, x + width - 1, y + height - 1, state);
+}
+
+    /**
+     * Fill a rectangle
+     *
+     * @param x      Left column
+     * @param y      Top row
+     * @param width  Width in pixels
+     * @param height Height in pixels
+     * @param state  One of the four possible states
+     */
+void PCA9532Canvas::fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t state) {
+
+  for (int16_t row = y; row < y + height; row++) {
+    for (int16_t col = x; col < x + width; col++) {
+      setPixel(col, row, state);
+    }
+  }
+}
+
+    /**
+     * Fill the whole canvas
+     *
+     * @param state One of the four possible states
+     */
+void PCA9532Canvas::fill(uint8_t state) {
+
+  fillRect(0, 0, _width, _height, state);
+}
+
+    /**
+     * Send all modified register images, one burst per device
+     */
+void PCA9532Canvas::flush() {
+
+  _fleet->flush();
+}
\ No newline at end of file
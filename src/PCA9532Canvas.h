@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532CANVAS_H
+#define PCA9532CANVAS_H
+
+#include "PCA9532Fleet.h"
+
+// Layout table entry for a pixel without LED (skipped pin or gap)
+#define CANVAS_NO_OUTPUT 0xFF
+
+/**
+ * Layout table entry, maps a pixel to a device of the fleet and an output
+ */
+struct PCA9532Pixel {
+    uint8_t device; // Index of the device in the fleet
+    uint8_t output; // Output LED0 to LED15, or CANVAS_NO_OUTPUT
+};
+
+class PCA9532Canvas {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a 2D canvas over a fleet of PCA9532. Pixel values are
+     * LED output states (LS_STATE_*). Drawing only modifies the register
+     * images of the fleet, flush() sends them in one burst per device
+     *
+     * @param fleet  Fleet holding the devices of the panel
+     * @param layout Layout table, width * height entries in row-major order
+     * @param width  Width of the canvas in pixels
+     * @param height Height of the canvas in pixels
+     */
+    PCA9532Canvas(PCA9532Fleet *fleet, const PCA9532Pixel *layout,
+                  uint8_t width, uint8_t height);
+
+    /**
+     * Fill a layout table for a serpentine wired panel: even rows run left
+     * to right, odd rows right to left, devices are chained with 16 outputs
+     * each. Outputs listed in skipMask are not connected and are skipped
+     *
+     * @param layout      Layout table to fill, width * height entries
+     * @param width       Width of the panel in pixels
+     * @param height      Height of the panel in pixels
+     * @param firstDevice Index of the first device in the fleet
+     * @param skipMask    Unconnected outputs of every device (bit n = LEDn)
+     *
+     * @return number of pixels mapped, 0 if skipMask leaves no output (all
+     *         pixels are set to CANVAS_NO_OUTPUT)
+     */
+    static uint16_t buildSerpentine(PCA9532Pixel *layout, uint8_t width, uint8_t height,
+                                    uint8_t firstDevice, uint16_t skipMask = 0);
+
+    /**
+     * Set a pixel, pixels outside the canvas are ignored
+     *
+     * @param x     Column
+     * @param y     Row
+     * @param state One of the four possible states
+     */
+    void setPixel(int16_t x, int16_t y, uint8_t state);
+
+    /**
+     * Draw a line (Bresenham)
+     *
+     * @param x0    Column of the start point
+     * @param y0    Row of the start point
+     * @param x1    Column of the end point
+     * @param y1    Row of the end point
+     * @param state One of the four possible states
+     */
+    void line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t state);
+
+    /**
+     * Draw the outline of a rectangle
+     *
+     * @param x      Left column
+     * @param y      Top row
+     * @param width  Width in pixels
+     * @param height Height in pixels
+     * @param state  One of the four possible states
+     */
+    void rect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t state);
+
+    /**
+     * Fill a rectangle
+     *
+     * @param x      Left column
+     * @param y      Top row
+     * @param width  Width in pixels
+     * @param height Height in pixels
+     * @param state  One of the four possible states
+     */
+    void fillRect(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t state);
+
+    /**
+     * Fill the whole canvas
+     *
+     * @param state One of the four possible states
+     */
+    void fill(uint8_t state);
+
+    /**
+     * Send all modified register images, one burst per device
+     */
+    void flush();
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    PCA9532Fleet *_fleet;
+    const PCA9532Pixel *_layout;
+    uint8_t _width;
+    uint8_t _height;
+};
+#endif //PCA9532CANVAS_H
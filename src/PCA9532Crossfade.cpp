@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Crossfade.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a hardware crossfade between two scenes. LEDs of the
+     * outgoing scene run on PWM0, LEDs of the incoming scene on PWM1, LEDs
+     * in both scenes stay on. The fade ramps PWM0 down and PWM1 up, then
+     * settles all LEDs to LS_STATE_ON / LS_STATE_OFF
+     *
+     * A crossfade costs one 10 byte burst to start, 5 bytes per step and a
+     * 6 byte burst to settle, independent of the number of LEDs. It
+     * overwrites PSC0, PWM0, PSC1 and PWM1
+     *
+     * @param device PCA9532 to fade
+     */
+PCA9532Crossfade::PCA9532Crossfade(PCA9532 *device) {
+
+  _device = device;
+  _running = false;
+}
+
+    /**
+     * Start a crossfade
+     *
+     * @param fromScene      LEDs on in the outgoing scene (bit n = LEDn)
+     * @param toScene        LEDs on in the incoming scene (bit n = LEDn)
+     * @param durationMillis Duration of the crossfade
+     * @param steps          Number of PWM steps
+     */
+void PCA9532Crossfade::start(uint16_t fromScene, uint16_t toScene, uint16_t durationMillis,
+                             uint8_t steps) {
+
+  if (steps == 0) {
+    steps = 1;
+  }
+
+  _toScene = toScene;
+  _steps = steps;
+  _step = 0;
+  _stepMicros = (uint32_t) durationMillis * 1000 / steps;
+  _start = micros();
+  _running = true;
+
+  // PSC0 to LS3 in one burst, fastest blink rate for dimming
+  _device->queueReg(REG_PSC0, 0);
+  _device->queueReg(REG_PWM0, 255);
+  _device->queueReg(REG_PSC1, 0);
+  _device->queueReg(REG_PWM1, 0);
+  queueLs(fromScene & toScene, fromScene & ~toScene, toScene & ~fromScene);
+  _device->flush();
+}
+
+    /**
+     * Advance the crossfade, sends a step only when it is due
+     *
+     * @return true while the crossfade is running
+     */
+bool PCA9532Crossfade::update() {
+
+  if (!_running) {
+    return false;
+  }
+
+  uint32_t elapsed = micros() - _start;
+  uint32_t step = _stepMicros ? elapsed / _stepMicros : _steps;
+
+  if (step <= _step) {
+    return true;
+  }
+
+  if (step >= _steps) {
+    // settle to the final on/off states with one burst
+    queueLs(_toScene, 0, 0);
+    _device->flush();
+    _running = false;
+    return false;
+  }
+
+  _step = step;
+
+  // PWM0, PSC1 and PWM1 in one burst
+  uint8_t pwm1 = (uint16_t) 255 * _step / _steps;
+  _device->queueReg(REG_PWM0, 255 - pwm1);
+  _device->queueReg(REG_PSC1, 0);
+  _device->queueReg(REG_PWM1, pwm1);
+  _device->flush();
+
+  return true;
+}
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if no crossfade is running
+     */
+uint32_t PCA9532Crossfade::nextDeadlineMicros() const {
+
+  if (!_running) {
+    return NO_DEADLINE;
+  }
+
+  uint32_t elapsed = micros() - _start;
+  uint32_t next = (uint32_t) (_step + 1) * _stepMicros;
+
+  return next > elapsed ? next - elapsed : 0;
+}
+
+    /**
+     * Check for a running crossfade
+     *
+     * @return true while the crossfade is running
+     */
+bool PCA9532Crossfade::isRunning() const {
+
+  return _running;
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Queue LS0 to LS3, LEDs in none of the masks are turned off
+     *
+     * @param onMask   LEDs to set to LS_STATE_ON
+     * @param pwm0Mask LEDs to set to LS_STATE_BLNK0
+     * @param pwm1Mask LEDs to set to LS_STATE_BLNK1
+     */
+void PCA9532Crossfade::queueLs(uint16_t onMask, uint16_t pwm0Mask, uint16_t pwm1Mask) {
+
+  for (uint8_t r = 0; r < 4; r++) {
+
+    uint8_t newReg = 0;
+
+    for (uint8_t i = 0; i < 4; i++) {
+      uint16_t bit = 1 << (r * 4 + i);
+      uint8_t state = LS_STATE_OFF;
+      if (onMask & bit) {
+        state = LS_STATE_ON;
+      } else if (pwm0Mask & bit) {
+        state = LS_STATE_BLNK0;
+      } else if (pwm1Mask & bit) {
+        state = LS_STATE_BLNK1;
+      }
+      newReg = PCA9532::packLsState(newReg, state, i * 2);
+    }
+
+    _device->queueReg(REG_LS0 + r, newReg);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532CROSSFADE_H
+#define PCA9532CROSSFADE_H
+
+#include "PCA9532.h"
+
+// Default number of PWM steps of a crossfade
+#define CROSSFADE_STEPS 8
+
+class PCA9532Crossfade {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a hardware crossfade between two scenes. LEDs of the
+     * outgoing scene run on PWM0, LEDs of the incoming scene on PWM1, LEDs
+     * in both scenes stay on. The fade ramps PWM0 down and PWM1 up, then
+     * settles all LEDs to LS_STATE_ON / LS_STATE_OFF
+     *
+     * A crossfade costs one 10 byte burst to start, 5 bytes per step and a
+     * 6 byte burst to settle, independent of the number of LEDs. It
+     * overwrites PSC0, PWM0, PSC1 and PWM1
+     *
+     * @param device PCA9532 to fade
+     */
+    PCA9532Crossfade(PCA9532 *device);
+
+    /**
+     * Start a crossfade
+     *
+     * @param fromScene      LEDs on in the outgoing scene (bit n = LEDn)
+     * @param toScene        LEDs on in the incoming scene (bit n = LEDn)
+     * @param durationMillis Duration of the crossfade
+     * @param steps          Number of PWM steps
+     */
+    void start(uint16_t fromScene, uint16_t toScene, uint16_t durationMillis,
+               uint8_t steps = CROSSFADE_STEPS);
+
+    /**
+     * Advance the crossfade, sends a step only when it is due
+     *
+     * @return true while the crossfade is running
+     */
+    bool update();
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if no crossfade is running
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Check for a running crossfade
+     *
+     * @return true while the crossfade is running
+     */
+    bool isRunning() const;
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Queue LS0 to LS3, LEDs in none of the masks are turned off
+     *
+     * @param onMask   LEDs to set to LS_STATE_ON
+     * @param pwm0Mask LEDs to set to LS_STATE_BLNK0
+     * @param pwm1Mask LEDs to set to LS_STATE_BLNK1
+     */
+    void queueLs(uint16_t onMask, uint16_t pwm0Mask, uint16_t pwm1Mask);
+
+    PCA9532 *_device;
+
+    uint16_t _toScene;
+    uint32_t _start;
+    uint32_t _stepMicros;
+    uint8_t _steps;
+    uint8_t _step;
+    bool _running;
+};
+#endif //PCA9532CROSSFADE_H
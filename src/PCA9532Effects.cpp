@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Effects.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a fixed-size pool of effects. Slots are taken from a
+     * free list and returned to it in O(1), without heap and without
+     * fragmentation. update() walks only the intrusive list of active
+     * effects. A handle holds the slot and its generation, so a handle of
+     * a finished effect never refers to an effect that reuses the slot
+     */
+PCA9532EffectPool::PCA9532EffectPool() {
+
+  for (uint8_t i = 0; i < PCA9532_EFFECT_POOL_SIZE; i++) {
+    _slots[i].step = NULL;
+    _slots[i].link = i + 1 < PCA9532_EFFECT_POOL_SIZE ? i + 1 : EFFECT_NO_SLOT;
+    _slots[i].generation = 0;
+  }
+
+  _free = 0;
+  _active = EFFECT_NO_SLOT;
+  _used = 0;
+  _updating = false;
+
+  resetStats();
+}
+
+    /**
+     * Start a linear fade of a register, e.g. REG_PWM0, from its current
+     * value in the register image. The register is written at most every
+     * EFFECT_MIN_INTERVAL_MICROS
+     *
+     * @param device          Device to fade
+     * @param registerAddress Register to fade
+     * @param to              End value
+     * @param durationMillis  Duration of the fade
+     *
+     * @return handle of the effect
+     * @return EFFECT_NONE if the pool is exhausted
+     */
+uint16_t PCA9532EffectPool::fade(PCA9532 *device, uint8_t registerAddress, uint8_t to, uint16_t durationMillis) {
+
+  uint16_t handle = start(device, fadeStep, NULL, durationMillis);
+
+  if (handle != EFFECT_NONE) {
+    PCA9532Effect &effect = _slots[handle & 0xFF];
+    effect.registerAddress = registerAddress;
+    effect.from = device->getRegImage(registerAddress);
+    effect.to = to;
+  }
+
+  return handle;
+}
+
+    /**
+     * Start a custom effect or sequence
+     *
+     * @param device         Device the effect writes to
+     * @param step           Step function
+     * @param context        User data passed in the effect
+     * @param durationMillis Duration, available to the step function
+     *
+     * @return handle of the effect
+     * @return EFFECT_NONE if the pool is exhausted
+     */
+uint16_t PCA9532EffectPool::start(PCA9532 *device, PCA9532EffectStep step, void *context, uint16_t durationMillis) {
+
+  uint8_t slot = allocate();
+
+  if (slot == EFFECT_NO_SLOT) {
+    return EFFECT_NONE;
+  }
+
+  PCA9532Effect &effect = _slots[slot];
+  effect.device = device;
+  effect.step = step;
+  effect.context = context;
+  effect.start = micros();
+  effect.duration = (uint32_t) durationMillis * 1000;
+  effect.next = 0;
+
+  return (uint16_t) effect.generation << 8 | slot;
+}
+
+    /**
+     * Stop an effect and return its slot to the pool. Handles of effects
+     * that already finished are ignored. Called from a step function, the
+     * effect does not step again and its slot is freed at the end of
+     * update()
+     *
+     * @param handle Handle of the effect
+     */
+void PCA9532EffectPool::stop(uint16_t handle) {
+
+  uint8_t slot = handle & 0xFF;
+
+  if (slot >= PCA9532_EFFECT_POOL_SIZE || _slots[slot].step == NULL
+      || _slots[slot].generation != handle >> 8) {
+    return;
+  }
+
+  if (_updating) {
+    // the walk of update() may be on this slot, free it after the walk
+    _slots[slot].next = NO_DEADLINE;
+    return;
+  }
+
+  release(slot);
+}
+
+    /**
+     * Run the step of every active effect that is due, flush the devices
+     * and free finished effects. Slots are freed after the walk, so a step
+     * may stop any effect, itself included
+     */
+void PCA9532EffectPool::update() {
+
+  uint32_t now = micros();
+
+  _updating = true;
+
+  // effects started by a step go to the front and run next time
+  for (uint8_t slot = _active; slot != EFFECT_NO_SLOT; slot = _slots[slot].link) {
+
+    PCA9532Effect &effect = _slots[slot];
+    uint32_t elapsed = now - effect.start;
+
+    if (effect.next != NO_DEADLINE && elapsed >= effect.next) {
+      uint32_t next = effect.step(effect, elapsed);
+      // a stop() from within the step wins
+      if (effect.next != NO_DEADLINE) {
+        effect.next = next;
+      }
+      effect.device->flush();
+    }
+  }
+
+  _updating = false;
+
+  // free finished and stopped effects
+  uint8_t slot = _active;
+
+  while (slot != EFFECT_NO_SLOT) {
+    uint8_t following = _slots[slot].link;
+    if (_slots[slot].next == NO_DEADLINE) {
+      release(slot);
+    }
+    slot = following;
+  }
+}
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if no effect is active
+     */
+uint32_t PCA9532EffectPool::nextDeadlineMicros() const {
+
+  uint32_t now = micros();
+  uint32_t deadline = NO_DEADLINE;
+
+  for (uint8_t slot = _active; slot != EFFECT_NO_SLOT; slot = _slots[slot].link) {
+    uint32_t elapsed = now - _slots[slot].start;
+    uint32_t remaining = _slots[slot].next > elapsed ? _slots[slot].next - elapsed : 0;
+    if (remaining < deadline) {
+      deadline = remaining;
+    }
+  }
+
+  return deadline;
+}
+
+    /**
+     * Number of active effects
+     *
+     * @return active effects
+     */
+uint8_t PCA9532EffectPool::getUsed() const {
+
+  return _used;
+}
+
+    /**
+     * Highest number of active effects since the last resetStats()
+     *
+     * @return high-water mark
+     */
+uint8_t PCA9532EffectPool::getHighWater() const {
+
+  return _highWater;
+}
+
+    /**
+     * Number of failed allocations since the last resetStats()
+     *
+     * @return failed allocations
+     */
+uint16_t PCA9532EffectPool::getAllocFailures() const {
+
+  return _allocFailures;
+}
+
+    /**
+     * Reset the pool statistics
+     */
+void PCA9532EffectPool::resetStats() {
+
+  _highWater = _used;
+  _allocFailures = 0;
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Take a slot from the free list and append it to the active list
+     *
+     * @return slot index or EFFECT_NO_SLOT
+     */
+uint8_t PCA9532EffectPool::allocate() {
+
+  uint8_t slot = _free;
+
+  if (slot == EFFECT_NO_SLOT) {
+    _allocFailures++;
+    return EFFECT_NO_SLOT;
+  }
+
+  _free = _slots[slot].link;
+
+  // push to the front of the active list
+  _slots[slot].prev = EFFECT_NO_SLOT;
+  _slots[slot].link = _active;
+  if (_active != EFFECT_NO_SLOT) {
+    _slots[_active].prev = slot;
+  }
+  _active = slot;
+
+  if (++_used > _highWater) {
+    _highWater = _used;
+  }
+
+  return slot;
+}
+
+    /**
+     * Unlink a slot from the active list and return it to the free list,
+     * invalidating the handle of its effect
+     *
+     * @param slot Slot index
+     */
+void PCA9532EffectPool::release(uint8_t slot) {
+
+  PCA9532Effect &effect = _slots[slot];
+
+  if (effect.prev != EFFECT_NO_SLOT) {
+    _slots[effect.prev].link = effect.link;
+  } else {
+    _active = effect.link;
+  }
+  if (effect.link != EFFECT_NO_SLOT) {
+    _slots[effect.link].prev = effect.prev;
+  }
+
+  effect.step = NULL;
+  effect.generation++;
+  effect.link = _free;
+  _free = slot;
+  _used--;
+}
+
+    /**
+     * Step function of fade()
+     */
+uint32_t PCA9532EffectPool::fadeStep(PCA9532Effect &effect, uint32_t elapsedMicros) {
+
+  if (elapsedMicros >= effect.duration) {
+    effect.device->queueReg(effect.registerAddress, effect.to);
+    return NO_DEADLINE;
+  }
+
+  int16_t delta = (int16_t) effect.to - effect.from;
+  uint16_t steps = delta < 0 ? -delta : delta;
+
+  if (steps == 0) {
+    return effect.duration;
+  }
+
+  uint8_t value = effect.from + (int16_t) ((int64_t) delta * elapsedMicros / effect.duration);
+
+  effect.device->queueReg(effect.registerAddress, value);
+
+  // next change of the value, but not earlier than the minimum interval
+  // and not later than the end of the fade
+  uint16_t done = value > effect.from ? value - effect.from : effect.from - value;
+  uint32_t next = ((uint64_t) (done + 1) * effect.duration + steps - 1) / steps;
+
+  if (next < elapsedMicros + EFFECT_MIN_INTERVAL_MICROS) {
+    next = elapsedMicros + EFFECT_MIN_INTERVAL_MICROS;
+  }
+
+  return next < effect.duration ? next : effect.duration;
+}
\ No newline at end of file
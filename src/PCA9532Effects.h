@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532EFFECTS_H
+#define PCA9532EFFECTS_H
+
+#include "PCA9532.h"
+
+// Number of effects that can run at the same time (override with a build flag)
+#ifndef PCA9532_EFFECT_POOL_SIZE
+#define PCA9532_EFFECT_POOL_SIZE 16
+#endif
+
+// Minimum time between two writes of a fade, 50 updates per second are
+// smooth to the eye (override with a build flag)
+#ifndef EFFECT_MIN_INTERVAL_MICROS
+#define EFFECT_MIN_INTERVAL_MICROS 20000
+#endif
+
+// Invalid effect handle, returned if the pool is exhausted
+#define EFFECT_NONE 0xFFFF
+
+// End of a list of slots
+#define EFFECT_NO_SLOT 0xFF
+
+static_assert(PCA9532_EFFECT_POOL_SIZE < EFFECT_NO_SLOT,
+              "PCA9532_EFFECT_POOL_SIZE must be below 255");
+
+struct PCA9532Effect;
+
+/**
+ * Step function of an effect. Queues the register updates for the elapsed
+ * time and returns when it needs to run again, relative to the start of the
+ * effect, or NO_DEADLINE when the effect is finished
+ */
+typedef uint32_t (*PCA9532EffectStep)(PCA9532Effect &effect, uint32_t elapsedMicros);
+
+/**
+ * Effect instance, lives in a slot of PCA9532EffectPool
+ */
+struct PCA9532Effect {
+    PCA9532 *device;          // Device the effect writes to
+    PCA9532EffectStep step;   // Step function
+    void *context;            // User data of custom effects
+    uint32_t start;           // micros() at start
+    uint32_t duration;        // Duration in microseconds
+    uint32_t next;            // Next step, relative to start
+    uint8_t registerAddress;  // Register of a fade
+    uint8_t from;             // Start value of a fade
+    uint8_t to;               // End value of a fade
+    uint8_t prev;             // Intrusive list links (slot indices)
+    uint8_t link;
+    uint8_t generation;       // Bumped when the slot is freed, part of the handle
+};
+
+class PCA9532EffectPool {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a fixed-size pool of effects. Slots are taken from a
+     * free list and returned to it in O(1), without heap and without
+     * fragmentation. update() walks only the intrusive list of active
+     * effects. A handle holds the slot and its generation, so a handle of
+     * a finished effect never refers to an effect that reuses the slot
+     */
+    PCA9532EffectPool();
+
+    /**
+     * Start a linear fade of a register, e.g. REG_PWM0, from its current
+     * value in the register image. The register is written at most every
+     * EFFECT_MIN_INTERVAL_MICROS
+     *
+     * @param device          Device to fade
+     * @param registerAddress Register to fade
+     * @param to              End value
+     * @param durationMillis  Duration of the fade
+     *
+     * @return handle of the effect
+     * @return EFFECT_NONE if the pool is exhausted
+     */
+    uint16_t fade(PCA9532 *device, uint8_t registerAddress, uint8_t to, uint16_t durationMillis);
+
+    /**
+     * Start a custom effect or sequence
+     *
+     * @param device         Device the effect writes to
+     * @param step           Step function
+     * @param context        User data passed in the effect
+     * @param durationMillis Duration, available to the step function
+     *
+     * @return handle of the effect
+     * @return EFFECT_NONE if the pool is exhausted
+     */
+    uint16_t start(PCA9532 *device, PCA9532EffectStep step, void *context, uint16_t durationMillis);
+
+    /**
+     * Stop an effect and return its slot to the pool. Handles of effects
+     * that already finished are ignored. Called from a step function, the
+     * effect does not step again and its slot is freed at the end of
+     * update()
+     *
+     * @param handle Handle of the effect
+     */
+    void stop(uint16_t handle);
+
+    /**
+     * Run the step of every active effect that is due, flush the devices
+     * and free finished effects. Slots are freed after the walk, so a step
+     * may stop any effect, itself included
+     */
+    void update();
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if no effect is active
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Number of active effects
+     *
+     * @return active effects
+     */
+    uint8_t getUsed() const;
+
+    /**
+     * Highest number of active effects since the last resetStats()
+     *
+     * @return high-water mark
+     */
+    uint8_t getHighWater() const;
+
+    /**
+     * Number of failed allocations since the last resetStats()
+     *
+     * @return failed allocations
+     */
+    uint16_t getAllocFailures() const;
+
+    /**
+     * Reset the pool statistics
+     */
+    void resetStats();
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Take a slot from the free list and append it to the active list
+     *
+     * @return slot index or EFFECT_NO_SLOT
+     */
+    uint8_t allocate();
+
+    /**
+     * Unlink a slot from the active list and return it to the free list,
+     * invalidating the handle of its effect
+     *
+     * @param slot Slot index
+     */
+    void release(uint8_t slot);
+
+    /**
+     * Step function of fade()
+     */
+    static uint32_t fadeStep(PCA9532Effect &effect, uint32_t elapsedMicros);
+
+    PCA9532Effect _slots[PCA9532_EFFECT_POOL_SIZE];
+
+    uint8_t _free;
+    uint8_t _active;
+    uint8_t _used;
+    uint8_t _highWater;
+    uint16_t _allocFailures;
+
+    /**
+     * true while update() walks the active list, stop() only marks the
+     * effect then
+     */
+    bool _updating;
+};
+#endif //PCA9532EFFECTS_H
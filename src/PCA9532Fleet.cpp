@@ -0,0 +1,698 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Fleet.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a fleet of PCA9532 sharing one I2C bus. The register
+     * images of all devices are kept register by register in contiguous
+     * arrays, pending devices are tracked in a dirty bitmap
+     *
+     * @param wire Reference to TwoWire for I2C communication
+     */
+PCA9532Fleet::PCA9532Fleet(TwoWire *wire) {
+
+  _wire = wire;
+  _count = 0;
+  _busErrors = 0;
+
+  _master = 255;
+  _ramping = false;
+
+  _busProfile = PCA9532::busProfileForClock(100000);
+
+  memset(_dirtyRegs, 0, sizeof(_dirtyRegs));
+  memset(_dirtyDevices, 0, sizeof(_dirtyDevices));
+
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+    _classInterval[c] = 0;
+    _classLast[c] = 0;
+    _classPriority[c] = 0;
+  }
+}
+
+    /**
+     * Initialization of the I2C bus
+     */
+void PCA9532Fleet::begin() {
+
+  _wire->begin();
+}
+
+    /**
+     * Add a device to the fleet. The register image starts with the
+     * power-on values of the device
+     *
+     * @param deviceAddress I2C address of the PCA9532
+     *
+     * @return index of the device in the fleet
+     * @return FLEET_NO_DEVICE if the fleet is full
+     */
+uint8_t PCA9532Fleet::addDevice(uint8_t deviceAddress) {
+
+  if (_count >= PCA9532_FLEET_MAX_DEVICES) {
+    return FLEET_NO_DEVICE;
+  }
+
+  uint8_t device = _count++;
+
+  _deviceAddress[device] = deviceAddress;
+
+  for (uint8_t r = 0; r < FLEET_REG_COUNT; r++) {
+    _regs[r][device] = PCA9532::POWER_ON_REGS[REG_PSC0 + r];
+  }
+  _basePwm0[device] = PCA9532::POWER_ON_REGS[REG_PWM0];
+  _basePwm1[device] = PCA9532::POWER_ON_REGS[REG_PWM1];
+  _curve[device] = NULL;
+  _deviceClass[device] = 0;
+
+  return device;
+}
+
+    /**
+     * Number of devices in the fleet
+     *
+     * @return number of devices added with addDevice()
+     */
+uint8_t PCA9532Fleet::count() const {
+
+  return _count;
+}
+
+    /**
+     * Set a register in the register image of a device. The device is
+     * marked pending only if the value changes
+     *
+     * @param device          Index of the device
+     * @param registerAddress Register address (REG_PSC0 to REG_LS3)
+     * @param data            Data to write
+     */
+void PCA9532Fleet::setReg(uint8_t device, uint8_t registerAddress, uint8_t data) {
+
+  if (device >= _count || registerAddress < REG_PSC0 || registerAddress >= REG_COUNT) {
+    return;
+  }
+
+  uint8_t r = registerAddress - REG_PSC0;
+
+  if (_regs[r][device] == data) {
+    return;
+  }
+
+  _regs[r][device] = data;
+  _dirtyRegs[device] |= 1 << r;
+  _dirtyDevices[_deviceClass[device]][device >> 5] |= (uint32_t) 1 << (device & 31);
+}
+
+    /**
+     * Get a register from the register image of a device
+     *
+     * @param device          Index of the device
+     * @param registerAddress Register address (REG_PSC0 to REG_LS3)
+     *
+     * @return stored register value
+     */
+uint8_t PCA9532Fleet::getReg(uint8_t device, uint8_t registerAddress) const {
+
+  return _regs[registerAddress - REG_PSC0][device];
+}
+
+    /**
+     * Set the LED output state for a given channel of a device
+     *
+     * @param device Index of the device
+     * @param state  One of the four possible states
+     * @param regLs  Register address of LS*
+     * @param lsBit  Lower bit of LS* (see BIT_LS_LED*)
+     */
+void PCA9532Fleet::setLsState(uint8_t device, uint8_t state, uint8_t regLs, uint8_t lsBit) {
+
+  setReg(device, regLs, PCA9532::packLsState(getReg(device, regLs), state, lsBit));
+}
+
+    /**
+     * Set PWM value for channels IO_0...IO_7 or IO_8...IO_15 of a device.
+     * The value written to the device is scaled by the master brightness
+     *
+     * @param device Index of the device
+     * @param regPwm Register address for PWM channel, REG_PWM0 or REG_PWM1
+     * @param pwm    PWM value
+     */
+void PCA9532Fleet::setPwm(uint8_t device, uint8_t regPwm, uint8_t pwm) {
+
+  if (device >= _count) {
+    return;
+  }
+
+  if (regPwm == REG_PWM0) {
+    _basePwm0[device] = pwm;
+  } else if (regPwm == REG_PWM1) {
+    _basePwm1[device] = pwm;
+  } else {
+    return;
+  }
+
+  setReg(device, regPwm, scalePwm(device, pwm));
+}
+
+    /**
+     * Set the dimming curve of a device. The scaled PWM value
+     * pwm * master / 255 is mapped through the curve, e.g. to compensate
+     * for different LED types across the installation
+     *
+     * @param device Index of the device
+     * @param curve  Table of 256 PWM values, NULL for linear (default)
+     */
+void PCA9532Fleet::setCurve(uint8_t device, const uint8_t *curve) {
+
+  if (device >= _count) {
+    return;
+  }
+
+  _curve[device] = curve;
+}
+
+    /**
+     * Set the master brightness of the fleet and apply it immediately in a
+     * single pass over all devices. Devices whose quantised PWM0/PWM1 did not
+     * change are skipped, the others get one burst each, chained with
+     * repeated STARTs and a single STOP at the end
+     *
+     * @param master Master brightness, 255 = PWM values as set
+     */
+void PCA9532Fleet::setMasterBrightness(uint8_t master) {
+
+  _master = master;
+  _ramping = false;
+
+  applyMaster();
+}
+
+    /**
+     * Get the current master brightness
+     *
+     * @return master brightness
+     */
+uint8_t PCA9532Fleet::getMasterBrightness() const {
+
+  return _master;
+}
+
+    /**
+     * Start a smooth ramp of the master brightness, driven by update()
+     *
+     * @param master         Target master brightness
+     * @param durationMillis Duration of the ramp
+     */
+void PCA9532Fleet::rampMasterBrightness(uint8_t master, uint16_t durationMillis) {
+
+  if (durationMillis == 0) {
+    setMasterBrightness(master);
+    return;
+  }
+
+  _rampFrom = _master;
+  _rampTo = master;
+  _rampDuration = (uint32_t) durationMillis * 1000;
+  _rampStart = micros();
+  _rampNext = 0;
+  _ramping = true;
+}
+
+    /**
+     * Advance a running ramp. A pass is applied only when the master value
+     * changes and at most once every rampIntervalMicros(), so a ramp never
+     * saturates the bus. Between two passes update() does no work
+     *
+     * @return true while a ramp is running
+     */
+bool PCA9532Fleet::update() {
+
+  if (!_ramping) {
+    return false;
+  }
+
+  uint32_t elapsed = micros() - _rampStart;
+
+  if (elapsed < _rampNext) {
+    return true;
+  }
+
+  int16_t delta = (int16_t) _rampTo - _rampFrom;
+  uint16_t steps = delta < 0 ? -delta : delta;
+  uint8_t master = _rampTo;
+
+  if (elapsed < _rampDuration) {
+    master = _rampFrom + (int16_t) ((int64_t) delta * elapsed / _rampDuration);
+  }
+
+  if (master != _master) {
+    _master = master;
+    applyMaster();
+  }
+
+  _ramping = master != _rampTo;
+
+  if (_ramping) {
+    // time of the next change of the master value, but not earlier than
+    // the minimum interval between two passes
+    uint16_t done = master > _rampFrom ? master - _rampFrom : _rampFrom - master;
+    _rampNext = ((uint64_t) (done + 1) * _rampDuration + steps - 1) / steps;
+    uint32_t interval = rampIntervalMicros();
+    if (_rampNext < elapsed + interval) {
+      _rampNext = elapsed + interval;
+    }
+  }
+
+  return _ramping;
+}
+
+    /**
+     * Minimum time between two master dimmer passes while ramping: a pass
+     * over all devices takes at most FLEET_RAMP_BUS_SHARE percent of the
+     * bus time, and passes are never closer than FLEET_RAMP_INTERVAL_MICROS
+     *
+     * @return interval in microseconds for the current devices and bus profile
+     */
+uint32_t PCA9532Fleet::rampIntervalMicros() const {
+
+  // worst pass: PWM0, PSC1 and PWM1 in one burst for every device
+  uint32_t pass = PCA9532::estimateBusMicros(_busProfile, _count, (uint32_t) _count * 5);
+  uint32_t interval = (uint64_t) pass * 100 / FLEET_RAMP_BUS_SHARE;
+
+  return interval > FLEET_RAMP_INTERVAL_MICROS ? interval : FLEET_RAMP_INTERVAL_MICROS;
+}
+
+    /**
+     * Set the bus cost model of the shared bus, e.g. a profile measured with
+     * extras/calibrate_bus.py (default: ideal 100kHz bus)
+     *
+     * @param profile Bus profile
+     */
+void PCA9532Fleet::setBusProfile(const PCA9532BusProfile &profile) {
+
+  _busProfile = profile;
+}
+
+    /**
+     * Configure a refresh class. Pending devices of a class are sent by
+     * service() at most once per interval, classes with higher priority
+     * are served first. All devices start in class 0 (interval 0, priority 0)
+     *
+     * @param refreshClass   Class 0 to FLEET_MAX_CLASSES - 1
+     * @param intervalMicros Minimum time between two refreshes of the class
+     * @param priority       Higher priorities get the bus budget first
+     */
+void PCA9532Fleet::setRefreshClass(uint8_t refreshClass, uint32_t intervalMicros, uint8_t priority) {
+
+  if (refreshClass >= FLEET_MAX_CLASSES) {
+    return;
+  }
+
+  _classInterval[refreshClass] = intervalMicros;
+  _classPriority[refreshClass] = priority;
+}
+
+    /**
+     * Assign a device to a refresh class
+     *
+     * @param device       Index of the device
+     * @param refreshClass Class 0 to FLEET_MAX_CLASSES - 1
+     */
+void PCA9532Fleet::setDeviceClass(uint8_t device, uint8_t refreshClass) {
+
+  if (device >= _count || refreshClass >= FLEET_MAX_CLASSES) {
+    return;
+  }
+
+  uint8_t w = device >> 5;
+  uint32_t bit = (uint32_t) 1 << (device & 31);
+  uint8_t previous = _deviceClass[device];
+
+  // a pending device stays pending in its new class
+  if (_dirtyDevices[previous][w] & bit) {
+    _dirtyDevices[previous][w] &= ~bit;
+    _dirtyDevices[refreshClass][w] |= bit;
+  }
+
+  _deviceClass[device] = refreshClass;
+}
+
+    /**
+     * Send pending devices of all refresh classes that are due, by class
+     * priority, within a budget of bus bytes. Devices that do not fit the
+     * remaining budget are skipped and a class with skipped devices stays
+     * due for the next call. Classes without pending devices cost nothing.
+     * A budget below FLEET_REG_COUNT + 2 bytes may never fit a device with
+     * all registers pending
+     *
+     * @param byteBudget Maximum number of bus bytes to send
+     *
+     * @return number of bus bytes sent
+     */
+uint16_t PCA9532Fleet::service(uint16_t byteBudget) {
+
+  uint32_t now = micros();
+  uint16_t budget = byteBudget;
+  uint8_t order[FLEET_MAX_CLASSES];
+
+  // classes by descending priority
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+    uint8_t i = c;
+    while (i > 0 && _classPriority[order[i - 1]] < _classPriority[c]) {
+      order[i] = order[i - 1];
+      i--;
+    }
+    order[i] = c;
+  }
+
+  for (uint8_t i = 0; i < FLEET_MAX_CLASSES; i++) {
+
+    uint8_t c = order[i];
+
+    if (now - _classLast[c] < _classInterval[c]) {
+      continue;
+    }
+
+    bool pending = false;
+    for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+      pending |= _dirtyDevices[c][w] != 0;
+    }
+    if (!pending) {
+      continue;
+    }
+
+    if (flushClass(c, budget)) {
+      _classLast[c] = now;
+    }
+  }
+
+  return byteBudget - budget;
+}
+
+    /**
+     * Send the pending registers of the next pending device in one burst
+     *
+     * @return true if a transaction was sent
+     * @return false if no device was pending
+     */
+bool PCA9532Fleet::flushNext() {
+
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+    for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+
+      uint32_t word = _dirtyDevices[c][w];
+
+      if (word != 0) {
+        sendDevice((w << 5) + __builtin_ctzl(word));
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+    /**
+     * Send the pending registers of all devices, one burst per device.
+     * Devices that do not acknowledge stay pending for the next flush()
+     */
+void PCA9532Fleet::flush() {
+
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+    for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+
+      // one pass over the devices pending now
+      uint32_t word = _dirtyDevices[c][w];
+
+      while (word != 0) {
+        sendDevice((w << 5) + __builtin_ctzl(word));
+        word &= word - 1;
+      }
+    }
+  }
+}
+
+    /**
+     * Number of failed transactions since the last resetBusErrors()
+     *
+     * @return bus errors
+     */
+uint32_t PCA9532Fleet::getBusErrors() const {
+
+  return _busErrors;
+}
+
+    /**
+     * Reset the bus error counter
+     */
+void PCA9532Fleet::resetBusErrors() {
+
+  _busErrors = 0;
+}
+
+    /**
+     * Check for pending devices
+     *
+     * @return true if any device has registers waiting to be sent
+     */
+bool PCA9532Fleet::isPending() const {
+
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+    for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+      if (_dirtyDevices[c][w]) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+    /**
+     * Time until update() or flush() needs to run again
+     *
+     * @return microseconds until the next ramp pass or pending flush (0 = now)
+     * @return NO_DEADLINE if nothing is scheduled
+     */
+uint32_t PCA9532Fleet::nextDeadlineMicros() const {
+
+  uint32_t now = micros();
+  uint32_t deadline = NO_DEADLINE;
+
+  for (uint8_t c = 0; c < FLEET_MAX_CLASSES; c++) {
+
+    bool pending = false;
+    for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+      pending |= _dirtyDevices[c][w] != 0;
+    }
+
+    if (pending) {
+      uint32_t elapsed = now - _classLast[c];
+      uint32_t remaining = elapsed < _classInterval[c] ? _classInterval[c] - elapsed : 0;
+      if (remaining < deadline) {
+        deadline = remaining;
+      }
+    }
+  }
+
+  if (_ramping) {
+    uint32_t elapsed = now - _rampStart;
+    uint32_t remaining = _rampNext > elapsed ? _rampNext - elapsed : 0;
+    if (remaining < deadline) {
+      deadline = remaining;
+    }
+  }
+
+  return deadline;
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Scale a PWM value of a device by the master brightness and its curve
+     *
+     * @param device Index of the device
+     * @param pwm    PWM value as set
+     *
+     * @return PWM value to write
+     */
+uint8_t PCA9532Fleet::scalePwm(uint8_t device, uint8_t pwm) const {
+
+  uint8_t scaled = ((uint16_t) pwm * _master + 127) / 255;
+
+  return _curve[device] ? _curve[device][scaled] : scaled;
+}
+
+    /**
+     * Send the pending registers of a device in one burst. The device
+     * stays pending if it does not acknowledge
+     *
+     * @param device Index of the device
+     *
+     * @return number of bus bytes sent
+     */
+uint8_t PCA9532Fleet::sendDevice(uint8_t device) {
+
+  uint8_t dirty = _dirtyRegs[device];
+
+  // one burst from the first to the last pending register, registers in
+  // between are resent unchanged which is cheaper than a new transaction
+  uint8_t first = __builtin_ctz(dirty);
+  uint8_t last = FLEET_REG_COUNT - 1;
+  while (!(dirty & (1 << last))) {
+    last--;
+  }
+
+  _wire->beginTransmission(_deviceAddress[device]);
+  _wire->write(AUTO_INCREMENT | (REG_PSC0 + first));
+  for (uint8_t r = first; r <= last; r++) {
+    _wire->write(_regs[r][device]);
+  }
+
+  if (_wire->endTransmission() != 0) {
+    _busErrors++;
+    return 2 + last - first + 1;
+  }
+
+  _dirtyRegs[device] = 0;
+  _dirtyDevices[_deviceClass[device]][device >> 5] &= ~((uint32_t) 1 << (device & 31));
+
+  return 2 + last - first + 1;
+}
+
+    /**
+     * Bus bytes needed to send the pending registers of a device
+     *
+     * @param device Index of the device
+     *
+     * @return number of bus bytes
+     */
+uint8_t PCA9532Fleet::deviceCost(uint8_t device) const {
+
+  uint8_t dirty = _dirtyRegs[device];
+  uint8_t first = __builtin_ctz(dirty);
+  uint8_t last = FLEET_REG_COUNT - 1;
+  while (!(dirty & (1 << last))) {
+    last--;
+  }
+
+  return 2 + last - first + 1;
+}
+
+    /**
+     * Send the pending devices of a refresh class within a byte budget.
+     * A device that does not fit the remaining budget is skipped, cheaper
+     * devices after it are still sent
+     *
+     * @param refreshClass Class to send
+     * @param budget       Remaining bus bytes, reduced by the bytes sent
+     *
+     * @return true if no device of the class is pending anymore
+     */
+bool PCA9532Fleet::flushClass(uint8_t refreshClass, uint16_t &budget) {
+
+  bool done = true;
+
+  for (uint8_t w = 0; w < FLEET_DIRTY_WORDS; w++) {
+
+    uint32_t word = _dirtyDevices[refreshClass][w];
+
+    while (word != 0) {
+
+      uint8_t device = (w << 5) + __builtin_ctzl(word);
+      word &= word - 1;
+
+      if (deviceCost(device) > budget) {
+        done = false;
+        continue;
+      }
+
+      budget -= sendDevice(device);
+    }
+
+    // devices that did not acknowledge stay pending
+    done &= _dirtyDevices[refreshClass][w] == 0;
+  }
+
+  return done;
+}
+
+    /**
+     * Write the PWM values of all devices for the current master brightness
+     * in one chained pass, skipping devices whose quantised values did not
+     * change. Registers sent are no longer pending
+     */
+void PCA9532Fleet::applyMaster() {
+
+  // the last device that changes ends the chain with a STOP
+  int16_t last = _count - 1;
+
+  while (last >= 0
+         && scalePwm(last, _basePwm0[last]) == _regs[REG_PWM0 - REG_PSC0][last]
+         && scalePwm(last, _basePwm1[last]) == _regs[REG_PWM1 - REG_PSC0][last]) {
+    last--;
+  }
+
+  for (uint8_t device = 0; (int16_t) device <= last; device++) {
+
+    uint8_t pwm0 = scalePwm(device, _basePwm0[device]);
+    uint8_t pwm1 = scalePwm(device, _basePwm1[device]);
+    bool changed0 = pwm0 != _regs[REG_PWM0 - REG_PSC0][device];
+    bool changed1 = pwm1 != _regs[REG_PWM1 - REG_PSC0][device];
+
+    if (!changed0 && !changed1) {
+      continue;
+    }
+
+    _regs[REG_PWM0 - REG_PSC0][device] = pwm0;
+    _regs[REG_PWM1 - REG_PSC0][device] = pwm1;
+
+    // a PWM register still pending from setPwm() goes out with the burst
+    uint8_t dirty = _dirtyRegs[device];
+    bool send0 = changed0 || (dirty & 1 << (REG_PWM0 - REG_PSC0));
+    bool send1 = changed1 || (dirty & 1 << (REG_PWM1 - REG_PSC0));
+    uint8_t sent;
+
+    _wire->beginTransmission(_deviceAddress[device]);
+    if (send0 && send1) {
+      // PWM0, PSC1, PWM1 in one burst
+      _wire->write(AUTO_INCREMENT | REG_PWM0);
+      _wire->write(pwm0);
+      _wire->write(_regs[REG_PSC1 - REG_PSC0][device]);
+      _wire->write(pwm1);
+      sent = 1 << (REG_PWM0 - REG_PSC0) | 1 << (REG_PSC1 - REG_PSC0) | 1 << (REG_PWM1 - REG_PSC0);
+    } else if (send0) {
+      _wire->write(REG_PWM0);
+      _wire->write(pwm0);
+      sent = 1 << (REG_PWM0 - REG_PSC0);
+    } else {
+      _wire->write(REG_PWM1);
+      _wire->write(pwm1);
+      sent = 1 << (REG_PWM1 - REG_PSC0);
+    }
+
+    // one chained pass: repeated STARTs between the devices
+    if (_wire->endTransmission(device == last) != 0) {
+      // resend with the next flush()
+      _busErrors++;
+      _dirtyRegs[device] |= sent;
+      _dirtyDevices[_deviceClass[device]][device >> 5] |= (uint32_t) 1 << (device & 31);
+      continue;
+    }
+
+    _dirtyRegs[device] &= ~sent;
+    if (_dirtyRegs[device] == 0) {
+      _dirtyDevices[_deviceClass[device]][device >> 5] &= ~((uint32_t) 1 << (device & 31));
+    }
+  }
+}
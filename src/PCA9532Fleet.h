@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532FLEET_H
+#define PCA9532FLEET_H
+
+#include "PCA9532.h"
+
+// Maximum number of devices in a fleet, the PCA9532 has 8 addresses per bus
+// (override with a build flag)
+#ifndef PCA9532_FLEET_MAX_DEVICES
+#define PCA9532_FLEET_MAX_DEVICES 8
+#endif
+
+// Writable registers PSC0 to LS3 stored per device
+#define FLEET_REG_COUNT (REG_COUNT - REG_PSC0)
+
+// Number of 32 bit words in the device dirty bitmap
+#define FLEET_DIRTY_WORDS ((PCA9532_FLEET_MAX_DEVICES + 31) / 32)
+
+// Number of refresh classes
+#ifndef FLEET_MAX_CLASSES
+#define FLEET_MAX_CLASSES 4
+#endif
+
+// Returned by addDevice() if the fleet is full
+#define FLEET_NO_DEVICE 0xFF
+
+// Minimum time between two master dimmer passes while ramping
+#define FLEET_RAMP_INTERVAL_MICROS 20000
+
+// Maximum share of the bus time taken by a running ramp, in percent
+#ifndef FLEET_RAMP_BUS_SHARE
+#define FLEET_RAMP_BUS_SHARE 50
+#endif
+
+class PCA9532Fleet {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a fleet of PCA9532 sharing one I2C bus. The register
+     * images of all devices are kept register by register in contiguous
+     * arrays, pending devices are tracked in a dirty bitmap
+     *
+     * @param wire Reference to TwoWire for I2C communication
+     */
+    PCA9532Fleet(TwoWire *wire);
+
+    /**
+     * Initialization of the I2C bus
+     */
+    void begin();
+
+    /**
+     * Add a device to the fleet. The register image starts with the
+     * power-on values of the device
+     *
+     * @param deviceAddress I2C address of the PCA9532
+     *
+     * @return index of the device in the fleet
+     * @return FLEET_NO_DEVICE if the fleet is full
+     */
+    uint8_t addDevice(uint8_t deviceAddress);
+
+    /**
+     * Number of devices in the fleet
+     *
+     * @return number of devices added with addDevice()
+     */
+    uint8_t count() const;
+
+    /**
+     * Set a register in the register image of a device. The device is
+     * marked pending only if the value changes
+     *
+     * @param device          Index of the device
+     * @param registerAddress Register address (REG_PSC0 to REG_LS3)
+     * @param data            Data to write
+     */
+    void setReg(uint8_t device, uint8_t registerAddress, uint8_t data);
+
+    /**
+     * Get a register from the register image of a device
+     *
+     * @param device          Index of the device
+     * @param registerAddress Register address (REG_PSC0 to REG_LS3)
+     *
+     * @return stored register value
+     */
+    uint8_t getReg(uint8_t device, uint8_t registerAddress) const;
+
+    /**
+     * Set the LED output state for a given channel of a device
+     *
+     * @param device Index of the device
+     * @param state  One of the four possible states
+     * @param regLs  Register address of LS*
+     * @param lsBit  Lower bit of LS* (see BIT_LS_LED*)
+     */
+    void setLsState(uint8_t device, uint8_t state, uint8_t regLs, uint8_t lsBit);
+
+    /**
+     * Set PWM value for channels IO_0...IO_7 or IO_8...IO_15 of a device.
+     * The value written to the device is scaled by the master brightness
+     *
+     * @param device Index of the device
+     * @param regPwm Register address for PWM channel, REG_PWM0 or REG_PWM1
+     * @param pwm    PWM value
+     */
+    void setPwm(uint8_t device, uint8_t regPwm, uint8_t pwm);
+
+    /**
+     * Set the dimming curve of a device. The scaled PWM value
+     * pwm * master / 255 is mapped through the curve, e.g. to compensate
+     * for different LED types across the installation
+     *
+     * @param device Index of the device
+     * @param curve  Table of 256 PWM values, NULL for linear (default)
+     */
+    void setCurve(uint8_t device, const uint8_t *curve);
+
+    /**
+     * Set the master brightness of the fleet and apply it immediately in a
+     * single pass over all devices. Devices whose quantised PWM0/PWM1 did not
+     * change are skipped, the others get one burst each, chained with
+     * repeated STARTs and a single STOP at the end
+     *
+     * @param master Master brightness, 255 = PWM values as set
+     */
+    void setMasterBrightness(uint8_t master);
+
+    /**
+     * Get the current master brightness
+     *
+     * @return master brightness
+     */
+    uint8_t getMasterBrightness() const;
+
+    /**
+     * Start a smooth ramp of the master brightness, driven by update()
+     *
+     * @param master         Target master brightness
+     * @param durationMillis Duration of the ramp
+     */
+    void rampMasterBrightness(uint8_t master, uint16_t durationMillis);
+
+    /**
+     * Advance a running ramp. A pass is applied only when the master value
+     * changes and at most once every rampIntervalMicros(), so a ramp never
+     * saturates the bus. Between two passes update() does no work
+     *
+     * @return true while a ramp is running
+     */
+    bool update();
+
+    /**
+     * Minimum time between two master dimmer passes while ramping: a pass
+     * over all devices takes at most FLEET_RAMP_BUS_SHARE percent of the
+     * bus time, and passes are never closer than FLEET_RAMP_INTERVAL_MICROS
+     *
+     * @return interval in microseconds for the current devices and bus profile
+     */
+    uint32_t rampIntervalMicros() const;
+
+    /**
+     * Set the bus cost model of the shared bus, e.g. a profile measured with
+     * extras/calibrate_bus.py (default: ideal 100kHz bus)
+     *
+     * @param profile Bus profile
+     */
+    void setBusProfile(const PCA9532BusProfile &profile);
+
+    /**
+     * Time until update() or flush() needs to run again
+     *
+     * @return microseconds until the next ramp pass or refresh (0 = now)
+     * @return NO_DEADLINE if nothing is scheduled
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Configure a refresh class. Pending devices of a class are sent by
+     * service() at most once per interval, classes with higher priority
+     * are served first. All devices start in class 0 (interval 0, priority 0)
+     *
+     * @param refreshClass   Class 0 to FLEET_MAX_CLASSES - 1
+     * @param intervalMicros Minimum time between two refreshes of the class
+     * @param priority       Higher priorities get the bus budget first
+     */
+    void setRefreshClass(uint8_t refreshClass, uint32_t intervalMicros, uint8_t priority);
+
+    /**
+     * Assign a device to a refresh class
+     *
+     * @param device       Index of the device
+     * @param refreshClass Class 0 to FLEET_MAX_CLASSES - 1
+     */
+    void setDeviceClass(uint8_t device, uint8_t refreshClass);
+
+    /**
+     * Send pending devices of all refresh classes that are due, by class
+     * priority, within a budget of bus bytes. Devices that do not fit the
+     * remaining budget are skipped and a class with skipped devices stays
+     * due for the next call. Classes without pending devices cost nothing.
+     * A budget below FLEET_REG_COUNT + 2 bytes may never fit a device with
+     * all registers pending
+     *
+     * @param byteBudget Maximum number of bus bytes to send
+     *
+     * @return number of bus bytes sent
+     */
+    uint16_t service(uint16_t byteBudget);
+
+    /**
+     * Send the pending registers of the next pending device in one burst
+     *
+     * @return true if a transaction was sent
+     * @return false if no device was pending
+     */
+    bool flushNext();
+
+    /**
+     * Send the pending registers of all devices, one burst per device.
+     * Devices that do not acknowledge stay pending for the next flush()
+     */
+    void flush();
+
+    /**
+     * Number of failed transactions since the last resetBusErrors()
+     *
+     * @return bus errors
+     */
+    uint32_t getBusErrors() const;
+
+    /**
+     * Reset the bus error counter
+     */
+    void resetBusErrors();
+
+    /**
+     * Check for pending devices
+     *
+     * @return true if any device has registers waiting to be sent
+     */
+    bool isPending() const;
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Register images, one array per register
+     */
+    uint8_t _regs[FLEET_REG_COUNT][PCA9532_FLEET_MAX_DEVICES];
+
+    /**
+     * Pending registers per device, one bit per register (bit 0 = PSC0)
+     */
+    uint8_t _dirtyRegs[PCA9532_FLEET_MAX_DEVICES];
+
+    /**
+     * Pending devices per refresh class, one bit per device
+     */
+    uint32_t _dirtyDevices[FLEET_MAX_CLASSES][FLEET_DIRTY_WORDS];
+
+    /**
+     * Refresh class of each device and the class settings
+     */
+    uint8_t _deviceClass[PCA9532_FLEET_MAX_DEVICES];
+    uint32_t _classInterval[FLEET_MAX_CLASSES];
+    uint32_t _classLast[FLEET_MAX_CLASSES];
+    uint8_t _classPriority[FLEET_MAX_CLASSES];
+
+    /**
+     * Scale a PWM value of a device by the master brightness and its curve
+     *
+     * @param device Index of the device
+     * @param pwm    PWM value as set
+     *
+     * @return PWM value to write
+     */
+    uint8_t scalePwm(uint8_t device, uint8_t pwm) const;
+
+    /**
+     * Send the pending registers of a device in one burst. The device
+     * stays pending if it does not acknowledge
+     *
+     * @param device Index of the device
+     *
+     * @return number of bus bytes sent
+     */
+    uint8_t sendDevice(uint8_t device);
+
+    /**
+     * Bus bytes needed to send the pending registers of a device
+     *
+     * @param device Index of the device
+     *
+     * @return number of bus bytes
+     */
+    uint8_t deviceCost(uint8_t device) const;
+
+    /**
+     * Send the pending devices of a refresh class within a byte budget.
+     * A device that does not fit the remaining budget is skipped, cheaper
+     * devices after it are still sent
+     *
+     * @param refreshClass Class to send
+     * @param budget       Remaining bus bytes, reduced by the bytes sent
+     *
+     * @return true if no device of the class is pending anymore
+     */
+    bool flushClass(uint8_t refreshClass, uint16_t &budget);
+
+    /**
+     * Write the PWM values of all devices for the current master brightness
+     * in one chained pass, skipping devices whose quantised values did not
+     * change. Registers sent are no longer pending
+     */
+    void applyMaster();
+
+    /**
+     * PWM values as set with setPwm(), before master dimming
+     */
+    uint8_t _basePwm0[PCA9532_FLEET_MAX_DEVICES];
+    uint8_t _basePwm1[PCA9532_FLEET_MAX_DEVICES];
+
+    /**
+     * Dimming curves of the devices
+     */
+    const uint8_t *_curve[PCA9532_FLEET_MAX_DEVICES];
+
+    /**
+     * Master brightness and ramp state
+     */
+    uint8_t _master;
+    uint8_t _rampFrom;
+    uint8_t _rampTo;
+    uint32_t _rampDuration;
+    uint32_t _rampStart;
+    uint32_t _rampNext;
+    bool _ramping;
+
+    /**
+     * Bus cost model (see setBusProfile())
+     */
+    PCA9532BusProfile _busProfile;
+
+    /**
+     * I2C addresses of the devices
+     */
+    uint8_t _deviceAddress[PCA9532_FLEET_MAX_DEVICES];
+
+    /**
+     * Number of devices
+     */
+    uint8_t _count;
+
+    /**
+     * Number of failed transactions
+     */
+    uint32_t _busErrors;
+
+    /**
+     * Object for I2C communication
+     */
+    TwoWire *_wire;
+};
+#endif //PCA9532FLEET_H
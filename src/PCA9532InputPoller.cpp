@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532InputPoller.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for an adaptive poller of INPUT0/INPUT1. The poll interval
+     * doubles with every poll without change until it reaches the slow
+     * bound, and drops to the fast bound on any change
+     *
+     * @param device     PCA9532 to poll
+     * @param fastMicros Poll interval after activity
+     * @param slowMicros Poll interval when idle
+     */
+PCA9532InputPoller::PCA9532InputPoller(PCA9532 *device, uint32_t fastMicros, uint32_t slowMicros) {
+
+  _device = device;
+  _inputs = 0;
+  _changed = 0;
+  _valid = false;
+  _lastPoll = 0;
+
+  setBounds(fastMicros, slowMicros);
+  resetStats();
+}
+
+    /**
+     * Change the polling bounds
+     *
+     * @param fastMicros Poll interval after activity
+     * @param slowMicros Poll interval when idle
+     */
+void PCA9532InputPoller::setBounds(uint32_t fastMicros, uint32_t slowMicros) {
+
+  _fastMicros = fastMicros;
+  _slowMicros = slowMicros < fastMicros ? fastMicros : slowMicros;
+  _interval = _fastMicros;
+}
+
+    /**
+     * Poll the inputs if the current interval has elapsed. Inputs read by
+     * other consumers of readInputs() since the last poll are reused if they
+     * are younger than the fast interval, the own sample never is
+     *
+     * @return true if the inputs changed
+     */
+bool PCA9532InputPoller::update() {
+
+  uint32_t now = micros();
+  uint32_t elapsed = now - _lastPoll;
+
+  if (_valid && elapsed < _interval) {
+    return false;
+  }
+
+  // only a sample taken after the last poll is new, so the accepted age is
+  // strictly below the time since then (0 reads from the device)
+  uint32_t window = _valid && elapsed < _fastMicros ? elapsed : _fastMicros;
+  uint32_t transactions = _device->getBusTransactions();
+  uint16_t inputs = _device->readInputs(window > 0 ? window - 1 : 0);
+
+  if (_device->getBusTransactions() != transactions) {
+    _pollCount++;
+  }
+
+  _lastPoll = now;
+  _changed = _valid ? inputs ^ _inputs : 0;
+  _inputs = inputs;
+
+  if (!_valid) {
+    _valid = true;
+    return false;
+  }
+
+  if (_changed == 0) {
+    // idle, back off towards the slow rate
+    _interval = _interval > _slowMicros / 2 ? _slowMicros : _interval * 2;
+    return false;
+  }
+
+  _interval = _fastMicros;
+  _eventCount++;
+  _sumLatency += elapsed;
+  if (elapsed > _maxLatency) {
+    _maxLatency = elapsed;
+  }
+
+  return true;
+}
+
+    /**
+     * Time until update() needs to poll again
+     *
+     * @return microseconds until the next poll (0 = now)
+     */
+uint32_t PCA9532InputPoller::nextDeadlineMicros() const {
+
+  if (!_valid) {
+    return 0;
+  }
+
+  uint32_t elapsed = micros() - _lastPoll;
+
+  return elapsed < _interval ? _interval - elapsed : 0;
+}
+
+    /**
+     * Get the inputs of the last poll
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+uint16_t PCA9532InputPoller::getInputs() const {
+
+  return _inputs;
+}
+
+    /**
+     * Get the inputs that changed at the last poll
+     *
+     * @return one bit per input, set if it changed
+     */
+uint16_t PCA9532InputPoller::getChanged() const {
+
+  return _changed;
+}
+
+    /**
+     * Get the current poll interval
+     *
+     * @return poll interval in microseconds
+     */
+uint32_t PCA9532InputPoller::getInterval() const {
+
+  return _interval;
+}
+
+    /**
+     * Number of polls since the last resetStats() that read the inputs from
+     * the device, polls served by another consumer's read are not counted
+     *
+     * @return polls
+     */
+uint32_t PCA9532InputPoller::getPollCount() const {
+
+  return _pollCount;
+}
+
+    /**
+     * Number of detected changes since the last resetStats()
+     *
+     * @return changes
+     */
+uint32_t PCA9532InputPoller::getEventCount() const {
+
+  return _eventCount;
+}
+
+    /**
+     * Worst-case detection latency since the last resetStats(), i.e. the
+     * longest time between the previous poll and a poll detecting a change
+     *
+     * @return latency in microseconds
+     */
+uint32_t PCA9532InputPoller::getMaxLatencyMicros() const {
+
+  return _maxLatency;
+}
+
+    /**
+     * Mean worst-case detection latency since the last resetStats()
+     *
+     * @return latency in microseconds
+     */
+uint32_t PCA9532InputPoller::getAvgLatencyMicros() const {
+
+  return _eventCount ? _sumLatency / _eventCount : 0;
+}
+
+    /**
+     * Reset the statistics
+     */
+void PCA9532InputPoller::resetStats() {
+
+  _pollCount = 0;
+  _eventCount = 0;
+  _maxLatency = 0;
+  _sumLatency = 0;
+}
\ No newline at end of file
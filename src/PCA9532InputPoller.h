@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532INPUTPOLLER_H
+#define PCA9532INPUTPOLLER_H
+
+#include "PCA9532.h"
+
+// Default polling bounds
+#define POLL_FAST_MICROS 5000UL   //   5ms after activity
+#define POLL_SLOW_MICROS 200000UL // 200ms when idle
+
+class PCA9532InputPoller {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for an adaptive poller of INPUT0/INPUT1. The poll interval
+     * doubles with every poll without change until it reaches the slow
+     * bound, and drops to the fast bound on any change
+     *
+     * @param device     PCA9532 to poll
+     * @param fastMicros Poll interval after activity
+     * @param slowMicros Poll interval when idle
+     */
+    PCA9532InputPoller(PCA9532 *device,
+                       uint32_t fastMicros = POLL_FAST_MICROS,
+                       uint32_t slowMicros = POLL_SLOW_MICROS);
+
+    /**
+     * Change the polling bounds
+     *
+     * @param fastMicros Poll interval after activity
+     * @param slowMicros Poll interval when idle
+     */
+    void setBounds(uint32_t fastMicros, uint32_t slowMicros);
+
+    /**
+     * Poll the inputs if the current interval has elapsed. Inputs read by
+     * other consumers of readInputs() since the last poll are reused if they
+     * are younger than the fast interval, the own sample never is
+     *
+     * @return true if the inputs changed
+     */
+    bool update();
+
+    /**
+     * Time until update() needs to poll again
+     *
+     * @return microseconds until the next poll (0 = now)
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Get the inputs of the last poll
+     *
+     * @return INPUT1 in the upper byte, INPUT0 in the lower byte
+     */
+    uint16_t getInputs() const;
+
+    /**
+     * Get the inputs that changed at the last poll
+     *
+     * @return one bit per input, set if it changed
+     */
+    uint16_t getChanged() const;
+
+    /**
+     * Get the current poll interval
+     *
+     * @return poll interval in microseconds
+     */
+    uint32_t getInterval() const;
+
+    /**
+     * Number of polls since the last resetStats() that read the inputs from
+     * the device, polls served by another consumer's read are not counted
+     *
+     * @return polls
+     */
+    uint32_t getPollCount() const;
+
+    /**
+     * Number of detected changes since the last resetStats()
+     *
+     * @return changes
+     */
+    uint32_t getEventCount() const;
+
+    /**
+     * Worst-case detection latency since the last resetStats(), i.e. the
+     * longest time between the previous poll and a poll detecting a change
+     *
+     * @return latency in microseconds
+     */
+    uint32_t getMaxLatencyMicros() const;
+
+    /**
+     * Mean worst-case detection latency since the last resetStats()
+     *
+     * @return latency in microseconds
+     */
+    uint32_t getAvgLatencyMicros() const;
+
+    /**
+     * Reset the statistics
+     */
+    void resetStats();
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    PCA9532 *_device;
+
+    uint32_t _fastMicros;
+    uint32_t _slowMicros;
+    uint32_t _interval;
+    uint32_t _lastPoll;
+
+    uint16_t _inputs;
+    uint16_t _changed;
+    bool _valid;
+
+    uint32_t _pollCount;
+    uint32_t _eventCount;
+    uint32_t _maxLatency;
+    uint32_t _sumLatency;
+};
+#endif //PCA9532INPUTPOLLER_H
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <string.h>
+#include "PCA9532Lookahead.h"
+#include "PCA9532Budget.h"
+
+// Brightness of a dimmed output for a PWM value (see PCA9532Panel)
+static uint8_t pwmLevel(uint8_t pwm) {
+
+  return (uint16_t) pwm * 255 / 256;
+}
+
+// Smallest PWM value for a brightness
+static uint8_t levelPwm(uint8_t level) {
+
+  uint16_t pwm = ((uint16_t) level * 256 + 254) / 255;
+
+  return pwm > 255 ? 255 : pwm;
+}
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for streaming frames to a device
+     *
+     * @param device   PCA9532 to stream to
+     * @param window   Frames to look ahead (1 to PCA9532_LOOKAHEAD_MAX_WINDOW)
+     * @param maxError Maximum brightness error per output
+     */
+PCA9532Lookahead::PCA9532Lookahead(PCA9532 *device, uint8_t window, uint8_t maxError) {
+
+  _device = device;
+  _window = window < 1 ? 1 : window > PCA9532_LOOKAHEAD_MAX_WINDOW ? PCA9532_LOOKAHEAD_MAX_WINDOW : window;
+  _maxError = maxError;
+  _count = 0;
+  _busBytes = 0;
+}
+
+    /**
+     * Add the next frame. Once the window is full, the oldest frame is
+     * planned and queued on the device, send it with PCA9532::flush()
+     *
+     * @param levels Brightness of LED0 to LED15
+     *
+     * @return true if a frame has been queued
+     */
+bool PCA9532Lookahead::push(const uint8_t *levels) {
+
+  memcpy(_frames[_count++], levels, LOOKAHEAD_OUTPUTS);
+
+  if (_count < _window) {
+    return false;
+  }
+
+  return drain();
+}
+
+    /**
+     * Queue the next buffered frame at the end of an animation
+     *
+     * @return true if a frame has been queued, false if none is left
+     */
+bool PCA9532Lookahead::drain() {
+
+  if (_count == 0) {
+    return false;
+  }
+
+  uint8_t prev[REG_COUNT];
+  uint8_t image[REG_COUNT];
+
+  for (uint8_t r = 0; r < REG_COUNT; r++) {
+    prev[r] = _device->getRegImage(r);
+  }
+
+  planFrame(prev, _frames, _count, _maxError, _device->getBusProfile(), image);
+
+  for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+    if (image[r] != prev[r]) {
+      _device->queueReg(r, image[r]);
+    }
+  }
+
+  _busBytes += cost(prev, image);
+
+  _count--;
+  memmove(_frames[0], _frames[1], _count * LOOKAHEAD_OUTPUTS);
+
+  return true;
+}
+
+    /**
+     * Bus bytes of the frames queued so far
+     *
+     * @return bytes
+     */
+uint32_t PCA9532Lookahead::getBusBytes() const {
+
+  return _busBytes;
+}
+
+    /**
+     * Plan a whole animation offline. With a window of 1 every frame is
+     * planned on its own under the same maximum error, the reference to
+     * compare longer windows with
+     *
+     * @param levels   Brightness of LED0 to LED15, one row per frame
+     * @param count    Number of frames
+     * @param window   Frames to look ahead (1 to PCA9532_LOOKAHEAD_MAX_WINDOW)
+     * @param maxError Maximum brightness error per output
+     * @param images   Register images, one row per frame (may be NULL)
+     * @param start    Register image before the first frame, NULL for the
+     *                 power-on defaults
+     * @param profile  Bus profile the bus time is minimised for, NULL for an
+     *                 ideal 100kHz bus
+     *
+     * @return bus bytes of the animation
+     */
+uint32_t PCA9532Lookahead::plan(const uint8_t (*levels)[LOOKAHEAD_OUTPUTS], uint16_t count,
+                                uint8_t window, uint8_t maxError,
+                                uint8_t (*images)[REG_COUNT], const uint8_t *start,
+                                const PCA9532BusProfile *profile) {
+
+  PCA9532BusProfile ideal = PCA9532::busProfileForClock(100000);
+  uint8_t prev[REG_COUNT];
+  uint8_t image[REG_COUNT];
+  uint32_t bytes = 0;
+
+  if (window < 1) {
+    window = 1;
+  } else if (window > PCA9532_LOOKAHEAD_MAX_WINDOW) {
+    window = PCA9532_LOOKAHEAD_MAX_WINDOW;
+  }
+
+  memcpy(prev, start ? start : PCA9532::POWER_ON_REGS, REG_COUNT);
+
+  for (uint16_t f = 0; f < count; f++) {
+    // receding horizon: plan the window, keep its first frame only
+    planFrame(prev, levels + f, count - f < window ? count - f : window, maxError,
+              profile ? *profile : ideal, image);
+    bytes += cost(prev, image);
+
+    if (images) {
+      memcpy(images[f], image, REG_COUNT);
+    }
+    memcpy(prev, image, REG_COUNT);
+  }
+
+  return bytes;
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Plan the first frame of a window
+     *
+     * @param prev     Register image before the window
+     * @param levels   Frames of the window
+     * @param count    Number of frames in the window
+     * @param maxError Maximum brightness error per output
+     * @param profile  Bus profile the bus time is minimised for
+     * @param image    Register image of the first frame (output)
+     */
+void PCA9532Lookahead::planFrame(const uint8_t *prev, const uint8_t (*levels)[LOOKAHEAD_OUTPUTS],
+                                 uint8_t count, uint8_t maxError, const PCA9532BusProfile &profile,
+                                 uint8_t *image) {
+
+  uint8_t pool[LOOKAHEAD_CANDIDATES][2];
+  uint8_t poolCount = 0;
+  uint8_t greedy[PCA9532_LOOKAHEAD_MAX_WINDOW][2];
+
+  // candidate pairs: the current one and the best one of every frame in
+  // the window, in both orders; the current pair comes first to win ties
+  pool[poolCount][0] = prev[REG_PWM0];
+  pool[poolCount++][1] = prev[REG_PWM1];
+
+  for (uint8_t f = 0; f < count; f++) {
+    greedyPair(levels[f], prev, greedy[f]);
+  }
+
+  for (uint8_t i = 0; i < 2 * count + 1; i++) {
+    uint8_t p0 = i == 0 ? prev[REG_PWM1] : greedy[(i - 1) / 2][(i - 1) % 2];
+    uint8_t p1 = i == 0 ? prev[REG_PWM0] : greedy[(i - 1) / 2][1 - (i - 1) % 2];
+    uint8_t c = 0;
+
+    while (c < poolCount && (pool[c][0] != p0 || pool[c][1] != p1)) {
+      c++;
+    }
+    if (c == poolCount) {
+      pool[poolCount][0] = p0;
+      pool[poolCount++][1] = p1;
+    }
+  }
+
+  // per frame, the pairs that keep every output within the maximum error
+  uint8_t cand[PCA9532_LOOKAHEAD_MAX_WINDOW][LOOKAHEAD_CANDIDATES];
+  uint8_t candCount[PCA9532_LOOKAHEAD_MAX_WINDOW];
+  uint8_t scratch[REG_COUNT];
+
+  for (uint8_t f = 0; f < count; f++) {
+    candCount[f] = 0;
+
+    for (uint8_t c = 0; c < poolCount; c++) {
+      bool own = (pool[c][0] == greedy[f][0] && pool[c][1] == greedy[f][1])
+              || (pool[c][0] == greedy[f][1] && pool[c][1] == greedy[f][0]);
+
+      if (own || assign(levels[f], pool[c], NULL, 0, scratch) <= maxError) {
+        cand[f][candCount[f]++] = c;
+      }
+    }
+  }
+
+  // fastest path through the window, one layer of images per frame
+  uint8_t layer[2][LOOKAHEAD_CANDIDATES][REG_COUNT];
+  uint32_t total[2][LOOKAHEAD_CANDIDATES];
+  uint8_t back[PCA9532_LOOKAHEAD_MAX_WINDOW][LOOKAHEAD_CANDIDATES];
+
+  for (uint8_t c = 0; c < candCount[0]; c++) {
+    assign(levels[0], pool[cand[0][c]], prev, maxError, layer[0][c]);
+    total[0][c] = busNanos(prev, layer[0][c], profile);
+  }
+
+  for (uint8_t f = 1; f < count; f++) {
+    uint8_t cur = f & 1;
+
+    for (uint8_t c = 0; c < candCount[f]; c++) {
+      total[cur][c] = 0xFFFFFFFFUL;
+
+      for (uint8_t p = 0; p < candCount[f - 1]; p++) {
+        assign(levels[f], pool[cand[f][c]], layer[!cur][p], maxError, scratch);
+        uint32_t t = total[!cur][p] + busNanos(layer[!cur][p], scratch, profile);
+
+        if (t < total[cur][c]) {
+          total[cur][c] = t;
+          back[f][c] = p;
+          memcpy(layer[cur][c], scratch, REG_COUNT);
+        }
+      }
+    }
+  }
+
+  uint8_t last = (count - 1) & 1;
+  uint8_t best = 0;
+
+  for (uint8_t c = 1; c < candCount[count - 1]; c++) {
+    if (total[last][c] < total[last][best]) {
+      best = c;
+    }
+  }
+
+  for (uint8_t f = count - 1; f > 0; f--) {
+    best = back[f][best];
+  }
+
+  assign(levels[0], pool[cand[0][best]], prev, maxError, image);
+}
+
+    /**
+     * PWM pair with the smallest maximum error for the dimmed levels of a
+     * frame
+     *
+     * @param levels Brightness of LED0 to LED15
+     * @param prev   Register image, its pair is kept if nothing is dimmed
+     * @param pair   PWM0 and PWM1 (output)
+     */
+void PCA9532Lookahead::greedyPair(const uint8_t *levels, const uint8_t *prev, uint8_t *pair) {
+
+  uint8_t dimmed[LOOKAHEAD_OUTPUTS];
+  uint8_t n = 0;
+
+  // sorted dimmed levels
+  for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+    uint8_t level = levels[o];
+    uint8_t i = n++;
+
+    if (level == 0 || level == 255) {
+      n--;
+      continue;
+    }
+    while (i > 0 && dimmed[i - 1] > level) {
+      dimmed[i] = dimmed[i - 1];
+      i--;
+    }
+    dimmed[i] = level;
+  }
+
+  if (n == 0) {
+    pair[0] = prev[REG_PWM0];
+    pair[1] = prev[REG_PWM1];
+    return;
+  }
+
+  // split into a lower and an upper group with the smallest maximum error
+  uint8_t split = n;
+  uint8_t error = dimmed[n - 1] - dimmed[0];
+
+  for (uint8_t k = 1; k < n; k++) {
+    uint8_t lower = dimmed[k - 1] - dimmed[0];
+    uint8_t upper = dimmed[n - 1] - dimmed[k];
+    uint8_t e = lower > upper ? lower : upper;
+
+    if (e < error) {
+      error = e;
+      split = k;
+    }
+  }
+
+  pair[0] = levelPwm(((uint16_t) dimmed[0] + dimmed[split - 1]) / 2);
+  pair[1] = split < n ? levelPwm(((uint16_t) dimmed[split] + dimmed[n - 1]) / 2) : pair[0];
+}
+
+    /**
+     * Register image of a frame for a PWM pair. Outputs keep their LS state
+     * of the previous image while it is within the maximum error
+     *
+     * @param levels   Brightness of LED0 to LED15
+     * @param pair     PWM0 and PWM1
+     * @param prev     Previous register image (PSC is copied from it)
+     * @param maxError Maximum brightness error per output
+     * @param image    Register image (output)
+     *
+     * @return largest error of an output
+     */
+uint8_t PCA9532Lookahead::assign(const uint8_t *levels, const uint8_t *pair, const uint8_t *prev,
+                                 uint8_t maxError, uint8_t *image) {
+
+  uint8_t value[4] = { 0, 255, pwmLevel(pair[0]), pwmLevel(pair[1]) };
+  uint8_t worst = 0;
+  uint8_t used = 0;
+
+  memcpy(image, prev ? prev : PCA9532::POWER_ON_REGS, REG_COUNT);
+  memset(image + REG_LS0, 0, 4);
+
+  for (uint8_t o = 0; o < LOOKAHEAD_OUTPUTS; o++) {
+    uint8_t state = LS_STATE_OFF;
+    uint8_t error = 255;
+
+    for (uint8_t s = LS_STATE_OFF; s <= LS_STATE_BLNK1; s++) {
+      uint8_t e = levels[o] > value[s] ? levels[o] - value[s] : value[s] - levels[o];
+
+      if (e < error) {
+        error = e;
+        state = s;
+      }
+    }
+
+    if (prev) {
+      uint8_t s = (prev[REG_LS0 + o / 4] >> (2 * (o % 4))) & 0x03;
+      uint8_t e = levels[o] > value[s] ? levels[o] - value[s] : value[s] - levels[o];
+
+      if (e <= maxError) {
+        error = e;
+        state = s;
+      }
+    }
+
+    used |= 1 << state;
+    worst = error > worst ? error : worst;
+    image[REG_LS0 + o / 4] = PCA9532::packLsState(image[REG_LS0 + o / 4], state, 2 * (o % 4));
+  }
+
+  // a PWM register no output blinks on does not need to change
+  image[REG_PWM0] = (used & (1 << LS_STATE_BLNK0)) || !prev ? pair[0] : prev[REG_PWM0];
+  image[REG_PWM1] = (used & (1 << LS_STATE_BLNK1)) || !prev ? pair[1] : prev[REG_PWM1];
+
+  return worst;
+}
+
+    /**
+     * Bus bytes to go from one register image to another
+     *
+     * @param prev  Previous register image
+     * @param image Next register image
+     *
+     * @return bytes
+     */
+uint8_t PCA9532Lookahead::cost(const uint8_t *prev, const uint8_t *image) {
+
+  return PCA9532Budget::bytes(changed(prev, image));
+}
+
+    /**
+     * Bus time to go from one register image to another
+     *
+     * @param prev    Previous register image
+     * @param image   Next register image
+     * @param profile Bus profile
+     *
+     * @return nanoseconds
+     */
+uint32_t PCA9532Lookahead::busNanos(const uint8_t *prev, const uint8_t *image,
+                                    const PCA9532BusProfile &profile) {
+
+  return PCA9532Budget::nanos(changed(prev, image), profile);
+}
+
+    /**
+     * Registers that differ between two register images
+     *
+     * @param prev  Previous register image
+     * @param image Next register image
+     *
+     * @return changed registers (bit n = register address n)
+     */
+uint16_t PCA9532Lookahead::changed(const uint8_t *prev, const uint8_t *image) {
+
+  uint16_t mask = 0;
+
+  for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+    if (image[r] != prev[r]) {
+      mask |= 1 << r;
+    }
+  }
+
+  return mask;
+}
\ No newline at end of file
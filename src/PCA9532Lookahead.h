@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532LOOKAHEAD_H
+#define PCA9532LOOKAHEAD_H
+
+#include "PCA9532.h"
+
+// Frames the planner looks ahead, can be overridden by a build flag
+#ifndef PCA9532_LOOKAHEAD_MAX_WINDOW
+#define PCA9532_LOOKAHEAD_MAX_WINDOW 4
+#endif
+
+#define LOOKAHEAD_OUTPUTS    16                                   // Brightness levels per frame
+#define LOOKAHEAD_CANDIDATES (2 * PCA9532_LOOKAHEAD_MAX_WINDOW + 4) // PWM pairs per frame
+
+/**
+ * Quantizes frames of 16 brightness levels (0 to 255) to register images:
+ * every output is OFF, ON, BLNK0 or BLNK1 with PWM0 and PWM1 as the two
+ * dimmed levels. Instead of picking the best PWM pair frame by frame, the
+ * planner looks a window of frames ahead and picks the pairs and LS states
+ * that take the least bus time over the window (bus profile of the device,
+ * see PCA9532::setBusProfile()), as long as no output is further than a
+ * maximum error from its level. PSC0 and PSC1 are left
+ * untouched and should blink fast enough to look dimmed (e.g. 0 = 152Hz).
+ */
+class PCA9532Lookahead {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for streaming frames to a device
+     *
+     * @param device   PCA9532 to stream to
+     * @param window   Frames to look ahead (1 to PCA9532_LOOKAHEAD_MAX_WINDOW)
+     * @param maxError Maximum brightness error per output
+     */
+    PCA9532Lookahead(PCA9532 *device, uint8_t window = PCA9532_LOOKAHEAD_MAX_WINDOW,
+                     uint8_t maxError = 8);
+
+    /**
+     * Add the next frame. Once the window is full, the oldest frame is
+     * planned and queued on the device, send it with PCA9532::flush()
+     *
+     * @param levels Brightness of LED0 to LED15
+     *
+     * @return true if a frame has been queued
+     */
+    bool push(const uint8_t *levels);
+
+    /**
+     * Queue the next buffered frame at the end of an animation
+     *
+     * @return true if a frame has been queued, false if none is left
+     */
+    bool drain();
+
+    /**
+     * Bus bytes of the frames queued so far
+     *
+     * @return bytes
+     */
+    uint32_t getBusBytes() const;
+
+    /**
+     * Plan a whole animation offline. With a window of 1 every frame is
+     * planned on its own under the same maximum error, the reference to
+     * compare longer windows with
+     *
+     * @param levels   Brightness of LED0 to LED15, one row per frame
+     * @param count    Number of frames
+     * @param window   Frames to look ahead (1 to PCA9532_LOOKAHEAD_MAX_WINDOW)
+     * @param maxError Maximum brightness error per output
+     * @param images   Register images, one row per frame (may be NULL)
+     * @param start    Register image before the first frame, NULL for the
+     *                 power-on defaults
+     * @param profile  Bus profile the bus time is minimised for, NULL for an
+     *                 ideal 100kHz bus
+     *
+     * @return bus bytes of the animation
+     */
+    static uint32_t plan(const uint8_t (*levels)[LOOKAHEAD_OUTPUTS], uint16_t count,
+                         uint8_t window, uint8_t maxError,
+                         uint8_t (*images)[REG_COUNT], const uint8_t *start = NULL,
+                         const PCA9532BusProfile *profile = NULL);
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Plan the first frame of a window
+     *
+     * @param prev     Register image before the window
+     * @param levels   Frames of the window
+     * @param count    Number of frames in the window
+     * @param maxError Maximum brightness error per output
+     * @param profile  Bus profile the bus time is minimised for
+     * @param image    Register image of the first frame (output)
+     */
+    static void planFrame(const uint8_t *prev, const uint8_t (*levels)[LOOKAHEAD_OUTPUTS],
+                          uint8_t count, uint8_t maxError, const PCA9532BusProfile &profile,
+                          uint8_t *image);
+
+    /**
+     * PWM pair with the smallest maximum error for the dimmed levels of a
+     * frame
+     *
+     * @param levels Brightness of LED0 to LED15
+     * @param prev   Register image, its pair is kept if nothing is dimmed
+     * @param pair   PWM0 and PWM1 (output)
+     */
+    static void greedyPair(const uint8_t *levels, const uint8_t *prev, uint8_t *pair);
+
+    /**
+     * Register image of a frame for a PWM pair. Outputs keep their LS state
+     * of the previous image while it is within the maximum error
+     *
+     * @param levels   Brightness of LED0 to LED15
+     * @param pair     PWM0 and PWM1
+     * @param prev     Previous register image (PSC is copied from it)
+     * @param maxError Maximum brightness error per output
+     * @param image    Register image (output)
+     *
+     * @return largest error of an output
+     */
+    static uint8_t assign(const uint8_t *levels, const uint8_t *pair, const uint8_t *prev,
+                          uint8_t maxError, uint8_t *image);
+
+    /**
+     * Bus bytes to go from one register image to another
+     *
+     * @param prev  Previous register image
+     * @param image Next register image
+     *
+     * @return bytes
+     */
+    static uint8_t cost(const uint8_t *prev, const uint8_t *image);
+
+    /**
+     * Bus time to go from one register image to another
+     *
+     * @param prev    Previous register image
+     * @param image   Next register image
+     * @param profile Bus profile
+     *
+     * @return nanoseconds
+     */
+    static uint32_t busNanos(const uint8_t *prev, const uint8_t *image,
+                             const PCA9532BusProfile &profile);
+
+    /**
+     * Registers that differ between two register images
+     *
+     * @param prev  Previous register image
+     * @param image Next register image
+     *
+     * @return changed registers (bit n = register address n)
+     */
+    static uint16_t changed(const uint8_t *prev, const uint8_t *image);
+
+    PCA9532 *_device;
+    uint8_t _window;
+    uint8_t _maxError;
+
+    uint8_t _frames[PCA9532_LOOKAHEAD_MAX_WINDOW][LOOKAHEAD_OUTPUTS];
+    uint8_t _count;
+
+    uint32_t _busBytes;
+};
+#endif //PCA9532LOOKAHEAD_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Panel.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Blink period for a prescaler value: (PSC + 1) / 152Hz
+     *
+     * @param psc Value of PSC0 or PSC1
+     *
+     * @return blink period in microseconds
+     */
+uint32_t PCA9532Panel::blinkPeriodMicros(uint8_t psc) {
+
+  return ((uint32_t) psc + 1) * 1000000UL / BLINK_BASE_HZ;
+}
+
+    /**
+     * LED output state of an output
+     *
+     * @param regImage Register image (REG_COUNT bytes)
+     * @param output   Output LED0 to LED15
+     *
+     * @return one of the four possible states
+     */
+uint8_t PCA9532Panel::outputState(const uint8_t *regImage, uint8_t output) {
+
+  return (regImage[REG_LS0 + (output >> 2)] >> ((output & 3) << 1)) & 0b11;
+}
+
+    /**
+     * Instantaneous brightness of an output. A blinking output is on for
+     * PWM / 256 of the blink period, starting at the period boundary
+     *
+     * @param regImage   Register image (REG_COUNT bytes)
+     * @param output     Output LED0 to LED15
+     * @param timeMicros Time since the blink timebase started
+     *
+     * @return 255 if the LED is on, 0 if it is off
+     */
+uint8_t PCA9532Panel::outputLevel(const uint8_t *regImage, uint8_t output, uint32_t timeMicros) {
+
+  return onMicros(regImage, output, timeMicros + 1) > onMicros(regImage, output, timeMicros) ? 255 : 0;
+}
+
+    /**
+     * Time-averaged brightness of an output over whole blink periods
+     *
+     * @param regImage Register image (REG_COUNT bytes)
+     * @param output   Output LED0 to LED15
+     *
+     * @return brightness 0 to 255
+     */
+uint8_t PCA9532Panel::outputBrightness(const uint8_t *regImage, uint8_t output) {
+
+  switch (outputState(regImage, output)) {
+    case LS_STATE_ON:
+      return 255;
+    case LS_STATE_BLNK0:
+      return (uint16_t) regImage[REG_PWM0] * 255 / 256;
+    case LS_STATE_BLNK1:
+      return (uint16_t) regImage[REG_PWM1] * 255 / 256;
+    default:
+      return 0;
+  }
+}
+
+    /**
+     * Time-averaged brightness of an output over a time window, e.g. one
+     * frame of an animation
+     *
+     * @param regImage    Register image (REG_COUNT bytes)
+     * @param output      Output LED0 to LED15
+     * @param startMicros Start of the window since the blink timebase started
+     * @param endMicros   End of the window
+     *
+     * @return brightness 0 to 255
+     */
+uint8_t PCA9532Panel::outputBrightness(const uint8_t *regImage, uint8_t output,
+                                       uint32_t startMicros, uint32_t endMicros) {
+
+  if (endMicros <= startMicros) {
+    return outputLevel(regImage, output, startMicros);
+  }
+
+  uint32_t on = onMicros(regImage, output, endMicros) - onMicros(regImage, output, startMicros);
+
+  return (uint64_t) on * 255 / (endMicros - startMicros);
+}
+
+    /**
+     * Time an output is on from the start of the blink timebase until a
+     * given time
+     *
+     * @param regImage   Register image (REG_COUNT bytes)
+     * @param output     Output LED0 to LED15
+     * @param timeMicros Time since the blink timebase started
+     *
+     * @return on time in microseconds
+     */
+uint32_t PCA9532Panel::onMicros(const uint8_t *regImage, uint8_t output, uint32_t timeMicros) {
+
+  uint8_t psc, pwm;
+
+  switch (outputState(regImage, output)) {
+    case LS_STATE_ON:
+      return timeMicros;
+    case LS_STATE_BLNK0:
+      psc = regImage[REG_PSC0];
+      pwm = regImage[REG_PWM0];
+      break;
+    case LS_STATE_BLNK1:
+      psc = regImage[REG_PSC1];
+      pwm = regImage[REG_PWM1];
+      break;
+    default:
+      return 0;
+  }
+
+  uint32_t period = blinkPeriodMicros(psc);
+  uint32_t onPerPeriod = (uint64_t) period * pwm / 256;
+  uint32_t phase = timeMicros % period;
+
+  return (timeMicros / period) * onPerPeriod + (phase < onPerPeriod ? phase : onPerPeriod);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532PANEL_H
+#define PCA9532PANEL_H
+
+#include "PCA9532.h"
+
+// Blink prescaler base frequency (page 7, table 6)
+#define BLINK_BASE_HZ 152
+
+class PCA9532Panel {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Blink period for a prescaler value: (PSC + 1) / 152Hz
+     *
+     * @param psc Value of PSC0 or PSC1
+     *
+     * @return blink period in microseconds
+     */
+    static uint32_t blinkPeriodMicros(uint8_t psc);
+
+    /**
+     * LED output state of an output
+     *
+     * @param regImage Register image (REG_COUNT bytes)
+     * @param output   Output LED0 to LED15
+     *
+     * @return one of the four possible states
+     */
+    static uint8_t outputState(const uint8_t *regImage, uint8_t output);
+
+    /**
+     * Instantaneous brightness of an output. A blinking output is on for
+     * PWM / 256 of the blink period, starting at the period boundary
+     *
+     * @param regImage   Register image (REG_COUNT bytes)
+     * @param output     Output LED0 to LED15
+     * @param timeMicros Time since the blink timebase started
+     *
+     * @return 255 if the LED is on, 0 if it is off
+     */
+    static uint8_t outputLevel(const uint8_t *regImage, uint8_t output, uint32_t timeMicros);
+
+    /**
+     * Time-averaged brightness of an output over whole blink periods
+     *
+     * @param regImage Register image (REG_COUNT bytes)
+     * @param output   Output LED0 to LED15
+     *
+     * @return brightness 0 to 255
+     */
+    static uint8_t outputBrightness(const uint8_t *regImage, uint8_t output);
+
+    /**
+     * Time-averaged brightness of an output over a time window, e.g. one
+     * frame of an animation
+     *
+     * @param regImage    Register image (REG_COUNT bytes)
+     * @param output      Output LED0 to LED15
+     * @param startMicros Start of the window since the blink timebase started
+     * @param endMicros   End of the window
+     *
+     * @return brightness 0 to 255
+     */
+    static uint8_t outputBrightness(const uint8_t *regImage, uint8_t output,
+                                    uint32_t startMicros, uint32_t endMicros);
+
+    /**
+     * Time an output is on from the start of the blink timebase until a
+     * given time
+     *
+     * @param regImage   Register image (REG_COUNT bytes)
+     * @param output     Output LED0 to LED15
+     * @param timeMicros Time since the blink timebase started
+     *
+     * @return on time in microseconds
+     */
+    static uint32_t onMicros(const uint8_t *regImage, uint8_t output, uint32_t timeMicros);
+};
+#endif //PCA9532PANEL_H
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532SevenSeg.h"
+
+// Font for 0 to 9 and A to F
+static const uint8_t FONT[16] PROGMEM = {
+  SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,         // 0
+  SEG_B | SEG_C,                                         // 1
+  SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,                 // 2
+  SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                 // 3
+  SEG_B | SEG_C | SEG_F | SEG_G,                         // 4
+  SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,                 // 5
+  SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,         // 6
+  SEG_A | SEG_B | SEG_C,                                 // 7
+  SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, // 8
+  SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G,         // 9
+  SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,         // A
+  SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,                 // b
+  SEG_A | SEG_D | SEG_E | SEG_F,                         // C
+  SEG_B | SEG_C | SEG_D | SEG_E | SEG_G,                 // d
+  SEG_A | SEG_D | SEG_E | SEG_F | SEG_G,                 // E
+  SEG_A | SEG_E | SEG_F | SEG_G                          // F
+};
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a seven-segment display of two digits per PCA9532:
+     * LED0 to LED7 drive segments a to g and dp of the left digit, LED8 to
+     * LED15 those of the right digit. Devices are chained left to right.
+     * Left digits blink at PWM0, right digits at PWM1, which sets their
+     * brightness
+     *
+     * @param devices Devices from left to right, must stay valid while in use
+     * @param count   Number of devices
+     */
+PCA9532SevenSeg::PCA9532SevenSeg(PCA9532 **devices, uint8_t count) {
+
+  _devices = devices;
+  _count = count * 2 <= PCA9532_SEVENSEG_MAX_DIGITS ? count : PCA9532_SEVENSEG_MAX_DIGITS / 2;
+  _digits = _count * 2;
+
+  memset(_segments, 0, sizeof(_segments));
+  memset(_decimalPoints, 0, sizeof(_decimalPoints));
+}
+
+    /**
+     * Initialize the devices: fastest blink rate, full brightness, blank
+     */
+void PCA9532SevenSeg::begin() {
+
+  for (uint8_t d = 0; d < _count; d++) {
+    for (uint8_t r = REG_PSC0; r < REG_COUNT; r++) {
+      _devices[d]->queueReg(r, r == REG_PWM0 || r == REG_PWM1 ? 255 : 0);
+    }
+    _devices[d]->flush();
+  }
+}
+
+    /**
+     * Set the brightness of a digit. Both digits of a device have their own
+     * PWM channel
+     *
+     * @param digit      Digit from the left
+     * @param brightness PWM value
+     */
+void PCA9532SevenSeg::setBrightness(uint8_t digit, uint8_t brightness) {
+
+  if (digit >= _digits) {
+    return;
+  }
+
+  PCA9532 *device = _devices[digit >> 1];
+  uint8_t regPwm = (digit & 1) ? REG_PWM1 : REG_PWM0;
+
+  if (device->getRegImage(regPwm) != brightness) {
+    device->setPwm(regPwm, brightness);
+  }
+}
+
+    /**
+     * Show a decimal number, right-aligned with leading zeros blanked. A
+     * number that does not fit, minus sign included, shows SEG_OVERFLOW
+     *
+     * @param value        Number to show
+     * @param leadingZeros true to show leading zeros
+     */
+void PCA9532SevenSeg::printNumber(int32_t value, bool leadingZeros) {
+
+  uint32_t magnitude = value < 0 ? -(uint32_t) value : value;
+
+  print(magnitude, 10, value < 0, leadingZeros);
+}
+
+    /**
+     * Show a hexadecimal number, right-aligned with leading zeros blanked. A
+     * number that does not fit shows SEG_OVERFLOW
+     *
+     * @param value        Number to show
+     * @param leadingZeros true to show leading zeros
+     */
+void PCA9532SevenSeg::printHex(uint32_t value, bool leadingZeros) {
+
+  print(value, 16, false, leadingZeros);
+}
+
+    /**
+     * Set the decimal point of a digit, kept across print*()
+     *
+     * @param digit Digit from the left
+     * @param on    true to light the decimal point
+     */
+void PCA9532SevenSeg::setDecimalPoint(uint8_t digit, bool on) {
+
+  if (digit >= _digits) {
+    return;
+  }
+
+  if (on) {
+    _decimalPoints[digit >> 3] |= 1 << (digit & 7);
+  } else {
+    _decimalPoints[digit >> 3] &= ~(1 << (digit & 7));
+  }
+}
+
+    /**
+     * Set the raw segments of a digit (see SEG_*), without decimal point
+     *
+     * @param digit    Digit from the left
+     * @param segments Segment bits
+     */
+void PCA9532SevenSeg::setSegments(uint8_t digit, uint8_t segments) {
+
+  if (digit >= _digits) {
+    return;
+  }
+
+  _segments[digit] = segments & ~SEG_DP;
+}
+
+    /**
+     * Write the changed segments. Only LS registers that differ from the
+     * devices are sent, e.g. a counter changing its last digit costs a
+     * single burst of one or two LS bytes
+     */
+void PCA9532SevenSeg::update() {
+
+  for (uint8_t d = 0; d < _count; d++) {
+
+    PCA9532 *device = _devices[d];
+
+    for (uint8_t half = 0; half < 2; half++) {
+
+      uint8_t digit = d * 2 + half;
+      uint8_t segments = _segments[digit];
+      uint8_t state = half ? LS_STATE_BLNK1 : LS_STATE_BLNK0;
+
+      if (_decimalPoints[digit >> 3] & (1 << (digit & 7))) {
+        segments |= SEG_DP;
+      }
+
+      // segments a to d in the lower LS register, e to dp in the upper one
+      for (uint8_t r = 0; r < 2; r++) {
+        uint8_t newReg = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+          if (segments & (1 << (r * 4 + i))) {
+            newReg = PCA9532::packLsState(newReg, state, i * 2);
+          }
+        }
+
+        uint8_t regLs = REG_LS0 + half * 2 + r;
+        if (device->getRegImage(regLs) != newReg) {
+          device->queueReg(regLs, newReg);
+        }
+      }
+    }
+
+    device->flush();
+  }
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Fill the digits with a number in a base, right-aligned, or with
+     * SEG_OVERFLOW if it does not fit
+     *
+     * @param value        Absolute value to show
+     * @param base         10 or 16
+     * @param negative     true to show a minus sign
+     * @param leadingZeros true to show leading zeros
+     */
+void PCA9532SevenSeg::print(uint32_t value, uint8_t base, bool negative, bool leadingZeros) {
+
+  if (_digits == 0) {
+    return;
+  }
+
+  int8_t digit = _digits - 1;
+
+  // digits from the right, at least one
+  do {
+    _segments[digit--] = pgm_read_byte(&FONT[value % base]);
+    value /= base;
+  } while (value > 0 && digit >= 0);
+
+  while (digit >= 0) {
+    if (negative && (!leadingZeros || digit == 0)) {
+      _segments[digit--] = SEG_G;
+      negative = false;
+    } else {
+      _segments[digit--] = leadingZeros ? pgm_read_byte(&FONT[0]) : 0;
+    }
+  }
+
+  // digits left over or no room for the minus sign
+  if (value > 0 || negative) {
+    memset(_segments, SEG_OVERFLOW, _digits);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532SEVENSEG_H
+#define PCA9532SEVENSEG_H
+
+#include "PCA9532.h"
+
+// Maximum number of digits of a display (two per device)
+#ifndef PCA9532_SEVENSEG_MAX_DIGITS
+#define PCA9532_SEVENSEG_MAX_DIGITS 16
+#endif
+
+// Segment bits of a digit, output n of the digit drives bit n
+#define SEG_A  0x01
+#define SEG_B  0x02
+#define SEG_C  0x04
+#define SEG_D  0x08
+#define SEG_E  0x10
+#define SEG_F  0x20
+#define SEG_G  0x40
+#define SEG_DP 0x80
+
+// Shown on every digit when a number does not fit the display
+#define SEG_OVERFLOW (SEG_A | SEG_D | SEG_G)
+
+class PCA9532SevenSeg {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a seven-segment display of two digits per PCA9532:
+     * LED0 to LED7 drive segments a to g and dp of the left digit, LED8 to
+     * LED15 those of the right digit. Devices are chained left to right.
+     * Left digits blink at PWM0, right digits at PWM1, which sets their
+     * brightness
+     *
+     * @param devices Devices from left to right, must stay valid while in use
+     * @param count   Number of devices
+     */
+    PCA9532SevenSeg(PCA9532 **devices, uint8_t count);
+
+    /**
+     * Initialize the devices: fastest blink rate, full brightness, blank
+     */
+    void begin();
+
+    /**
+     * Set the brightness of a digit. Both digits of a device have their own
+     * PWM channel
+     *
+     * @param digit      Digit from the left
+     * @param brightness PWM value
+     */
+    void setBrightness(uint8_t digit, uint8_t brightness);
+
+    /**
+     * Show a decimal number, right-aligned with leading zeros blanked. A
+     * number that does not fit, minus sign included, shows SEG_OVERFLOW
+     *
+     * @param value        Number to show
+     * @param leadingZeros true to show leading zeros
+     */
+    void printNumber(int32_t value, bool leadingZeros = false);
+
+    /**
+     * Show a hexadecimal number, right-aligned with leading zeros blanked. A
+     * number that does not fit shows SEG_OVERFLOW
+     *
+     * @param value        Number to show
+     * @param leadingZeros true to show leading zeros
+     */
+    void printHex(uint32_t value, bool leadingZeros = false);
+
+    /**
+     * Set the decimal point of a digit, kept across print*()
+     *
+     * @param digit Digit from the left
+     * @param on    true to light the decimal point
+     */
+    void setDecimalPoint(uint8_t digit, bool on);
+
+    /**
+     * Set the raw segments of a digit (see SEG_*), without decimal point
+     *
+     * @param digit    Digit from the left
+     * @param segments Segment bits
+     */
+    void setSegments(uint8_t digit, uint8_t segments);
+
+    /**
+     * Write the changed segments. Only LS registers that differ from the
+     * devices are sent, e.g. a counter changing its last digit costs a
+     * single burst of one or two LS bytes
+     */
+    void update();
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Fill the digits with a number in a base, right-aligned, or with
+     * SEG_OVERFLOW if it does not fit
+     *
+     * @param value        Absolute value to show
+     * @param base         10 or 16
+     * @param negative     true to show a minus sign
+     * @param leadingZeros true to show leading zeros
+     */
+    void print(uint32_t value, uint8_t base, bool negative, bool leadingZeros);
+
+    PCA9532 **_devices;
+    uint8_t _count;
+    uint8_t _digits;
+
+    uint8_t _segments[PCA9532_SEVENSEG_MAX_DIGITS];
+    uint8_t _decimalPoints[(PCA9532_SEVENSEG_MAX_DIGITS + 7) / 8];
+};
+#endif //PCA9532SEVENSEG_H
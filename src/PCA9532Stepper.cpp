@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include <math.h>
+#include "PCA9532Stepper.h"
+
+// LS bytes of the phases, coils A, B, A', B' on LS_STATE_ON (output LOW)
+static const uint8_t PHASES_WAVE[4] = { 0x01, 0x04, 0x10, 0x40 };
+static const uint8_t PHASES_FULL[4] = { 0x05, 0x14, 0x50, 0x41 };
+static const uint8_t PHASES_HALF[8] = { 0x01, 0x05, 0x04, 0x14, 0x10, 0x50, 0x40, 0x41 };
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a unipolar stepper or a bank of four relays on the
+     * four outputs of one LS register (coil A, B, A', B' on the outputs
+     * from BIT_LS_LEDn 0 to 6). Phase tables hold the precomputed LS byte
+     * of every phase, so each step is a single-register write of 3 bytes
+     * without read before write
+     *
+     * @param device PCA9532 driving the coils
+     * @param regLs  Register address of the LS register of the coil group
+     * @param mode   STEP_MODE_WAVE, STEP_MODE_FULL or STEP_MODE_HALF
+     */
+PCA9532Stepper::PCA9532Stepper(PCA9532 *device, uint8_t regLs, uint8_t mode) {
+
+  _device = device;
+  _regLs = regLs;
+
+  switch (mode) {
+    case STEP_MODE_WAVE:
+      setPhaseTable(PHASES_WAVE, sizeof(PHASES_WAVE));
+      break;
+    case STEP_MODE_HALF:
+      setPhaseTable(PHASES_HALF, sizeof(PHASES_HALF));
+      break;
+    default:
+      setPhaseTable(PHASES_FULL, sizeof(PHASES_FULL));
+      break;
+  }
+
+  _position = 0;
+  _target = 0;
+  _n = 0;
+  _direction = 0;
+  _cn = 0;
+  _lastStep = 0;
+  _interval = 0;
+
+  setMaxSpeed(100);
+  setAcceleration(100);
+}
+
+    /**
+     * Use a custom phase table, e.g. a relay sequence
+     *
+     * @param phases LS bytes of the phases, must stay valid while in use
+     * @param count  Number of phases
+     */
+void PCA9532Stepper::setPhaseTable(const uint8_t *phases, uint8_t count) {
+
+  _phases = phases;
+  _phaseCount = count;
+}
+
+    /**
+     * Set the maximum speed
+     *
+     * @param stepsPerSecond Maximum speed, values of 0 or below are ignored
+     */
+void PCA9532Stepper::setMaxSpeed(float stepsPerSecond) {
+
+  // also rejects NaN, an infinite interval does not fit the step timer
+  if (!(stepsPerSecond > 0)) {
+    return;
+  }
+
+  _maxSpeed = stepsPerSecond;
+  _cmin = 1000000.0 / stepsPerSecond;
+}
+
+    /**
+     * Set the acceleration and deceleration
+     *
+     * @param stepsPerSecond2 Acceleration in steps per second squared, values
+     *                        of 0 or below are ignored
+     */
+void PCA9532Stepper::setAcceleration(float stepsPerSecond2) {
+
+  if (!(stepsPerSecond2 > 0)) {
+    return;
+  }
+
+  // first step interval of a ramp from standstill (Austin, equation 15)
+  _acceleration = stepsPerSecond2;
+  _c0 = 0.676 * sqrt(2.0 / stepsPerSecond2) * 1000000.0;
+}
+
+    /**
+     * Move to an absolute position with the acceleration profile
+     *
+     * @param position Target position in steps
+     */
+void PCA9532Stepper::moveTo(int32_t position) {
+
+  if (position == _target) {
+    return;
+  }
+
+  _target = position;
+
+  if (_interval == 0) {
+    // start from standstill right away
+    _lastStep = micros();
+    computeInterval();
+    _lastStep -= _interval;
+  }
+}
+
+    /**
+     * Move relative to the current position
+     *
+     * @param steps Number of steps, negative to move backwards
+     */
+void PCA9532Stepper::move(int32_t steps) {
+
+  moveTo(_position + steps);
+}
+
+    /**
+     * Do one step if it is due
+     *
+     * @return true while moving
+     */
+bool PCA9532Stepper::update() {
+
+  if (_interval == 0) {
+    return false;
+  }
+
+  uint32_t now = micros();
+
+  if (now - _lastStep < _interval) {
+    return true;
+  }
+
+  _position += _direction;
+  writePhase();
+  _lastStep = now;
+
+  computeInterval();
+
+  return _interval != 0;
+}
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if not moving
+     */
+uint32_t PCA9532Stepper::nextDeadlineMicros() const {
+
+  if (_interval == 0) {
+    return NO_DEADLINE;
+  }
+
+  uint32_t elapsed = micros() - _lastStep;
+
+  return elapsed < _interval ? _interval - elapsed : 0;
+}
+
+    /**
+     * De-energize all coils
+     */
+void PCA9532Stepper::release() {
+
+  _device->queueReg(_regLs, LS_STATE_OFF, PRIORITY_HIGH);
+  _device->flushStep();
+}
+
+    /**
+     * Current position
+     *
+     * @return position in steps
+     */
+int32_t PCA9532Stepper::getPosition() const {
+
+  return _position;
+}
+
+    /**
+     * Highest step rate the bus allows with the bus profile of the device
+     *
+     * @return steps per second
+     */
+uint32_t PCA9532Stepper::maxStepRate() const {
+
+  // one transaction of address, register and LS byte per step
+  return 1000000UL / _device->estimateBusMicros(1, 3);
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Write the LS byte of the current phase
+     */
+void PCA9532Stepper::writePhase() {
+
+  int32_t phase = _position % _phaseCount;
+
+  if (phase < 0) {
+    phase += _phaseCount;
+  }
+
+  // a step overtakes queued bulk traffic and goes out as one register write
+  _device->queueReg(_regLs, _phases[phase], PRIORITY_HIGH);
+  _device->flushStep();
+}
+
+    /**
+     * Compute the interval of the next step (acceleration profile)
+     */
+void PCA9532Stepper::computeInterval() {
+
+  int32_t distance = _target - _position;
+  int32_t stepsToStop = _n < 0 ? -_n : _n;
+
+  if (distance == 0 && stepsToStop <= 1) {
+    // arrived
+    _n = 0;
+    _direction = 0;
+    _interval = 0;
+    return;
+  }
+
+  int8_t wanted = distance > 0 ? 1 : -1;
+
+  if (_n > 0) {
+    // accelerating: start braking when the target is near or behind
+    if (stepsToStop >= wanted * distance || wanted != _direction) {
+      _n = -stepsToStop;
+    }
+  } else if (_n < 0) {
+    // decelerating: accelerate again if the target moved away
+    if (stepsToStop < wanted * distance && wanted == _direction) {
+      _n = -_n;
+    }
+  }
+
+  if (_n == 0) {
+    _cn = _c0;
+    _direction = wanted;
+  } else {
+    _cn = _cn - 2.0 * _cn / (4.0 * _n + 1);
+    if (_cn < _cmin) {
+      _cn = _cmin;
+      // cruising: stop counting so braking takes as many steps as ramping
+      _n--;
+    }
+  }
+
+  _n++;
+  // 0 means standing still, very slow settings must not overflow
+  _interval = _cn < 1 ? 1 : _cn < 4000000000.0 ? (uint32_t) _cn : 4000000000UL;
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532STEPPER_H
+#define PCA9532STEPPER_H
+
+#include "PCA9532.h"
+
+// Phase sequences
+#define STEP_MODE_WAVE 0 // One coil at a time (4 phases)
+#define STEP_MODE_FULL 1 // Two coils at a time (4 phases)
+#define STEP_MODE_HALF 2 // Alternating one and two coils (8 phases)
+
+class PCA9532Stepper {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a unipolar stepper or a bank of four relays on the
+     * four outputs of one LS register (coil A, B, A', B' on the outputs
+     * from BIT_LS_LEDn 0 to 6). Phase tables hold the precomputed LS byte
+     * of every phase, so each step is a single-register write of 3 bytes
+     * without read before write
+     *
+     * @param device PCA9532 driving the coils
+     * @param regLs  Register address of the LS register of the coil group
+     * @param mode   STEP_MODE_WAVE, STEP_MODE_FULL or STEP_MODE_HALF
+     */
+    PCA9532Stepper(PCA9532 *device, uint8_t regLs, uint8_t mode = STEP_MODE_FULL);
+
+    /**
+     * Use a custom phase table, e.g. a relay sequence
+     *
+     * @param phases LS bytes of the phases, must stay valid while in use
+     * @param count  Number of phases
+     */
+    void setPhaseTable(const uint8_t *phases, uint8_t count);
+
+    /**
+     * Set the maximum speed
+     *
+     * @param stepsPerSecond Maximum speed, values of 0 or below are ignored
+     */
+    void setMaxSpeed(float stepsPerSecond);
+
+    /**
+     * Set the acceleration and deceleration
+     *
+     * @param stepsPerSecond2 Acceleration in steps per second squared, values
+     *                        of 0 or below are ignored
+     */
+    void setAcceleration(float stepsPerSecond2);
+
+    /**
+     * Move to an absolute position with the acceleration profile
+     *
+     * @param position Target position in steps
+     */
+    void moveTo(int32_t position);
+
+    /**
+     * Move relative to the current position
+     *
+     * @param steps Number of steps, negative to move backwards
+     */
+    void move(int32_t steps);
+
+    /**
+     * Do one step if it is due
+     *
+     * @return true while moving
+     */
+    bool update();
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next step (0 = now)
+     * @return NO_DEADLINE if not moving
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * De-energize all coils
+     */
+    void release();
+
+    /**
+     * Current position
+     *
+     * @return position in steps
+     */
+    int32_t getPosition() const;
+
+    /**
+     * Highest step rate the bus allows with the bus profile of the device
+     *
+     * @return steps per second
+     */
+    uint32_t maxStepRate() const;
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Write the LS byte of the current phase
+     */
+    void writePhase();
+
+    /**
+     * Compute the interval of the next step (acceleration profile)
+     */
+    void computeInterval();
+
+    PCA9532 *_device;
+    uint8_t _regLs;
+
+    const uint8_t *_phases;
+    uint8_t _phaseCount;
+
+    int32_t _position;
+    int32_t _target;
+
+    float _maxSpeed;
+    float _acceleration;
+    float _c0;
+    float _cn;
+    float _cmin;
+    int32_t _n;
+    int8_t _direction;
+
+    uint32_t _lastStep;
+    uint32_t _interval;
+};
+#endif //PCA9532STEPPER_H
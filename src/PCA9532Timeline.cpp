@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Timeline.h"
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a keyframe timeline over one track per device. The
+     * sorted keyframes are the index: seeking is a binary search per track
+     *
+     * @param tracks Tracks, must stay valid while in use
+     * @param count  Number of tracks (at most PCA9532_TIMELINE_MAX_TRACKS)
+     */
+PCA9532Timeline::PCA9532Timeline(PCA9532Track *tracks, uint8_t count) {
+
+  _tracks = tracks;
+  _count = count < PCA9532_TIMELINE_MAX_TRACKS ? count : PCA9532_TIMELINE_MAX_TRACKS;
+
+  _source = NULL;
+  _playStart = 0;
+  _playOffset = 0;
+  _lastTime = 0;
+  _playing = false;
+
+  for (uint8_t t = 0; t < PCA9532_TIMELINE_MAX_TRACKS; t++) {
+    _position[t] = KEYFRAME_NONE;
+  }
+}
+
+    /**
+     * Follow an external time source (e.g. video timecode) instead of the
+     * time since play()
+     *
+     * @param source Time source, NULL to use millis() since play()
+     */
+void PCA9532Timeline::setTimeSource(PCA9532TimeSource source) {
+
+  _source = source;
+}
+
+    /**
+     * Start playback at a show time
+     *
+     * @param timeMillis Show time to start at
+     */
+void PCA9532Timeline::play(uint32_t timeMillis) {
+
+  _playStart = millis();
+  _playOffset = timeMillis;
+  _playing = true;
+
+  seek(now());
+}
+
+    /**
+     * Stop playback
+     */
+void PCA9532Timeline::stop() {
+
+  _playing = false;
+}
+
+    /**
+     * Jump to a show time. The full register image of every device at that
+     * time is sent in one burst per device, the power-on image for a device
+     * whose first keyframe is later
+     *
+     * @param timeMillis Show time to jump to
+     */
+void PCA9532Timeline::seek(uint32_t timeMillis) {
+
+  for (uint8_t t = 0; t < _count; t++) {
+
+    const PCA9532Track &track = _tracks[t];
+    uint16_t index = find(track, timeMillis);
+
+    _position[t] = index;
+
+    // before the first keyframe, the track shows the power-on values
+    const uint8_t *regs = index == KEYFRAME_NONE ? &PCA9532::POWER_ON_REGS[REG_PSC0] : track.keyframes[index].regs;
+
+    // the whole image, PSC0 to LS3 go out as a single burst
+    for (uint8_t r = 0; r < KEYFRAME_REG_COUNT; r++) {
+      track.device->queueReg(REG_PSC0 + r, regs[r]);
+    }
+    track.device->flush();
+  }
+
+  _lastTime = timeMillis;
+}
+
+    /**
+     * Follow the show time. Keyframes passed since the last update are
+     * skipped, only the registers of the latest one that differ from the
+     * device are sent. A jump backwards of the time source is handled like
+     * seek()
+     */
+void PCA9532Timeline::update() {
+
+  if (!_playing) {
+    return;
+  }
+
+  uint32_t time = now();
+
+  if (time < _lastTime) {
+    seek(time);
+    return;
+  }
+
+  for (uint8_t t = 0; t < _count; t++) {
+
+    const PCA9532Track &track = _tracks[t];
+    uint16_t index = _position[t];
+    uint16_t next = index == KEYFRAME_NONE ? 0 : index + 1;
+
+    if (next >= track.count || track.keyframes[next].timeMillis > time) {
+      continue;
+    }
+
+    // catch up: skip every keyframe that is already in the past
+    if (next + 1 < track.count && track.keyframes[next + 1].timeMillis <= time) {
+      next = find(track, time);
+    }
+
+    _position[t] = next;
+    apply(track, next);
+    track.device->flush();
+  }
+
+  _lastTime = time;
+}
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next keyframe (0 = now)
+     * @return NO_DEADLINE if stopped or at the end of all tracks
+     */
+uint32_t PCA9532Timeline::nextDeadlineMicros() const {
+
+  if (!_playing) {
+    return NO_DEADLINE;
+  }
+
+  uint32_t time = now();
+  uint32_t deadline = NO_DEADLINE;
+
+  for (uint8_t t = 0; t < _count; t++) {
+
+    uint16_t next = _position[t] == KEYFRAME_NONE ? 0 : _position[t] + 1;
+
+    if (next >= _tracks[t].count) {
+      continue;
+    }
+
+    uint32_t at = _tracks[t].keyframes[next].timeMillis;
+    // saturate, keyframes more than 71 minutes ahead would overflow
+    uint32_t remaining = at <= time ? 0
+                       : at - time < (NO_DEADLINE - 1) / 1000 ? (at - time) * 1000 : NO_DEADLINE - 1;
+    if (remaining < deadline) {
+      deadline = remaining;
+    }
+  }
+
+  return deadline;
+}
+
+    /**
+     * Current show time
+     *
+     * @return show time in milliseconds
+     */
+uint32_t PCA9532Timeline::now() const {
+
+  if (_source) {
+    return _source();
+  }
+
+  return _playOffset + (millis() - _playStart);
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Index of the last keyframe at or before a time (binary search)
+     *
+     * @param track      Track to search
+     * @param timeMillis Show time
+     *
+     * @return keyframe index or KEYFRAME_NONE
+     */
+uint16_t PCA9532Timeline::find(const PCA9532Track &track, uint32_t timeMillis) {
+
+  uint16_t low = 0;
+  uint16_t high = track.count;
+
+  // first keyframe after timeMillis
+  while (low < high) {
+    uint16_t mid = low + (high - low) / 2;
+    if (track.keyframes[mid].timeMillis <= timeMillis) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low == 0 ? KEYFRAME_NONE : low - 1;
+}
+
+    /**
+     * Queue the registers of a keyframe that differ from the device
+     *
+     * @param track Track of the device
+     * @param index Keyframe index
+     */
+void PCA9532Timeline::apply(const PCA9532Track &track, uint16_t index) {
+
+  const uint8_t *regs = track.keyframes[index].regs;
+
+  for (uint8_t r = 0; r < KEYFRAME_REG_COUNT; r++) {
+    if (track.device->getRegImage(REG_PSC0 + r) != regs[r]) {
+      track.device->queueReg(REG_PSC0 + r, regs[r]);
+    }
+  }
+}
\ No newline at end of file
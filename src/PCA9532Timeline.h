@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532TIMELINE_H
+#define PCA9532TIMELINE_H
+
+#include "PCA9532.h"
+
+// Registers PSC0 to LS3 stored per keyframe
+#define KEYFRAME_REG_COUNT (REG_COUNT - REG_PSC0)
+
+// Maximum number of tracks (override with a build flag)
+#ifndef PCA9532_TIMELINE_MAX_TRACKS
+#define PCA9532_TIMELINE_MAX_TRACKS 8
+#endif
+
+// Track position before the first keyframe
+#define KEYFRAME_NONE 0xFFFF
+
+/**
+ * Keyframe: full register image of a device from a point in time on
+ */
+struct PCA9532Keyframe {
+    uint32_t timeMillis;                 // Show time of the keyframe
+    uint8_t regs[KEYFRAME_REG_COUNT];    // PSC0 to LS3
+};
+
+/**
+ * Keyframes of one device, sorted by time
+ */
+struct PCA9532Track {
+    PCA9532 *device;
+    const PCA9532Keyframe *keyframes;
+    uint16_t count;
+};
+
+/**
+ * External time source, returns the show time in milliseconds
+ */
+typedef uint32_t (*PCA9532TimeSource)();
+
+class PCA9532Timeline {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a keyframe timeline over one track per device. The
+     * sorted keyframes are the index: seeking is a binary search per track
+     *
+     * @param tracks Tracks, must stay valid while in use
+     * @param count  Number of tracks (at most PCA9532_TIMELINE_MAX_TRACKS)
+     */
+    PCA9532Timeline(PCA9532Track *tracks, uint8_t count);
+
+    /**
+     * Follow an external time source (e.g. video timecode) instead of the
+     * time since play()
+     *
+     * @param source Time source, NULL to use millis() since play()
+     */
+    void setTimeSource(PCA9532TimeSource source);
+
+    /**
+     * Start playback at a show time
+     *
+     * @param timeMillis Show time to start at
+     */
+    void play(uint32_t timeMillis = 0);
+
+    /**
+     * Stop playback
+     */
+    void stop();
+
+    /**
+     * Jump to a show time. The full register image of every device at that
+     * time is sent in one burst per device, the power-on image for a device
+     * whose first keyframe is later
+     *
+     * @param timeMillis Show time to jump to
+     */
+    void seek(uint32_t timeMillis);
+
+    /**
+     * Follow the show time. Keyframes passed since the last update are
+     * skipped, only the registers of the latest one that differ from the
+     * device are sent. A jump backwards of the time source is handled like
+     * seek()
+     */
+    void update();
+
+    /**
+     * Time until update() needs to run again
+     *
+     * @return microseconds until the next keyframe (0 = now)
+     * @return NO_DEADLINE if stopped or at the end of all tracks
+     */
+    uint32_t nextDeadlineMicros() const;
+
+    /**
+     * Current show time
+     *
+     * @return show time in milliseconds
+     */
+    uint32_t now() const;
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Index of the last keyframe at or before a time (binary search)
+     *
+     * @param track      Track to search
+     * @param timeMillis Show time
+     *
+     * @return keyframe index or KEYFRAME_NONE
+     */
+    static uint16_t find(const PCA9532Track &track, uint32_t timeMillis);
+
+    /**
+     * Queue the registers of a keyframe that differ from the device
+     *
+     * @param track Track of the device
+     * @param index Keyframe index
+     */
+    static void apply(const PCA9532Track &track, uint16_t index);
+
+    PCA9532Track *_tracks;
+    uint8_t _count;
+
+    PCA9532TimeSource _source;
+    uint32_t _playStart;
+    uint32_t _playOffset;
+    uint32_t _lastTime;
+    bool _playing;
+
+    /**
+     * Current keyframe per track
+     */
+    uint16_t _position[PCA9532_TIMELINE_MAX_TRACKS];
+};
+#endif //PCA9532TIMELINE_H
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#include "PCA9532Worker.h"
+
+#ifdef PCA9532_HAS_WORKER
+
+#ifndef ARDUINO
+#include <thread>
+#endif
+
+#define QUEUE_MASK (PCA9532_WORKER_QUEUE_SIZE - 1)
+
+/******************************* PUBLIC METHODS *******************************/
+
+
+    /**
+     * Constructor for a bus worker. Application threads enqueue commands
+     * with the set* methods, which never touch the bus. A single worker
+     * thread or task calls run() or process(), coalesces the commands per
+     * device and sends them in bursts
+     */
+PCA9532Worker::PCA9532Worker() {
+
+  for (uint32_t i = 0; i < PCA9532_WORKER_QUEUE_SIZE; i++) {
+    _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  _enqueuePos.store(0, std::memory_order_relaxed);
+  _dequeuePos = 0;
+  _touchedCount = 0;
+  _running.store(false, std::memory_order_relaxed);
+}
+
+    /**
+     * Enqueue a register write (any thread, lock-free)
+     *
+     * @param device          PCA9532 to write to
+     * @param registerAddress Register address to write to
+     * @param data            Data to write
+     *
+     * @return false if the queue is full
+     */
+bool PCA9532Worker::setReg(PCA9532 *device, uint8_t registerAddress, uint8_t data) {
+
+  PCA9532Command command = { device, registerAddress, 0xFF, data };
+
+  return enqueue(command);
+}
+
+    /**
+     * Enqueue the LED output state for a given channel (any thread, lock-free)
+     *
+     * @param device PCA9532 to write to
+     * @param state  One of the four possible states
+     * @param regLs  Register address of LS*
+     * @param lsBit  Lower bit of LS* (see BIT_LS_LED*)
+     *
+     * @return false if the queue is full
+     */
+bool PCA9532Worker::setLsState(PCA9532 *device, uint8_t state, uint8_t regLs, uint8_t lsBit) {
+
+  // the mask is a channel packed with all state bits set
+  PCA9532Command command = { device, regLs, PCA9532::packLsState(0, 0b11, lsBit),
+                             PCA9532::packLsState(0, state, lsBit) };
+
+  return enqueue(command);
+}
+
+    /**
+     * Enqueue a PWM value for channels IO_0...IO_7 or IO_8...IO_15
+     * (any thread, lock-free)
+     *
+     * @param device PCA9532 to write to
+     * @param regPwm Register address for PWM channel
+     * @param pwm    PWM value
+     *
+     * @return false if the queue is full
+     */
+bool PCA9532Worker::setPwm(PCA9532 *device, uint8_t regPwm, uint8_t pwm) {
+
+  return setReg(device, regPwm, pwm);
+}
+
+    /**
+     * Move up to PCA9532_WORKER_QUEUE_SIZE commands from the queue into the
+     * register images and flush every touched device (worker thread only).
+     * The batch is capped so producers that keep the queue filled cannot
+     * hold back the flush
+     *
+     * @return number of commands processed
+     */
+uint16_t PCA9532Worker::process() {
+
+  PCA9532Command command;
+  uint16_t processed = 0;
+
+  while (processed < PCA9532_WORKER_QUEUE_SIZE && dequeue(command)) {
+
+    PCA9532 *device = command.device;
+    uint8_t data = (device->getRegImage(command.registerAddress) & ~command.mask) | command.value;
+
+    // commands for the same register coalesce in the register image
+    device->queueReg(command.registerAddress, data);
+    processed++;
+
+    uint8_t i = 0;
+    while (i < _touchedCount && _touched[i] != device) {
+      i++;
+    }
+    if (i == _touchedCount) {
+      if (_touchedCount == PCA9532_WORKER_MAX_DEVICES) {
+        // batch full, flush the devices touched so far and start over
+        flushTouched();
+      }
+      _touched[_touchedCount++] = device;
+    }
+  }
+
+  flushTouched();
+
+  return processed;
+}
+
+    /**
+     * Process commands until stop() is called (worker thread only)
+     */
+void PCA9532Worker::run() {
+
+  _running.store(true, std::memory_order_release);
+
+  while (_running.load(std::memory_order_acquire)) {
+    if (process() == 0) {
+#ifdef ARDUINO
+      yield();
+#else
+      std::this_thread::yield();
+#endif
+    }
+  }
+}
+
+    /**
+     * Make run() return after the current batch (any thread)
+     */
+void PCA9532Worker::stop() {
+
+  _running.store(false, std::memory_order_release);
+}
+
+/****************************** PRIVATE METHODS *******************************/
+
+
+    /**
+     * Enqueue a command (multiple producers)
+     *
+     * @param command Command to enqueue
+     *
+     * @return false if the queue is full
+     */
+bool PCA9532Worker::enqueue(const PCA9532Command &command) {
+
+  uint32_t pos = _enqueuePos.load(std::memory_order_relaxed);
+  Cell *cell;
+
+  for (;;) {
+    cell = &_cells[pos & QUEUE_MASK];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t) (sequence - pos);
+
+    if (diff == 0) {
+      // cell is free, claim it
+      if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      // another producer claimed the cell
+      pos = _enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->command = command;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+    /**
+     * Dequeue a command (single consumer)
+     *
+     * @param command Dequeued command
+     *
+     * @return false if the queue is empty
+     */
+bool PCA9532Worker::dequeue(PCA9532Command &command) {
+
+  Cell *cell = &_cells[_dequeuePos & QUEUE_MASK];
+  uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+
+  if ((int32_t) (sequence - (_dequeuePos + 1)) < 0) {
+    return false;
+  }
+
+  command = cell->command;
+  cell->sequence.store(_dequeuePos + PCA9532_WORKER_QUEUE_SIZE, std::memory_order_release);
+  _dequeuePos++;
+
+  return true;
+}
+
+#endif //PCA9532_HAS_WORKER
+
+    /**
+     * Flush every device touched by the current batch and start a new one
+     */
+void PCA9532Worker::flushTouched() {
+
+  for (uint8_t i = 0; i < _touchedCount; i++) {
+    _touched[i]->flush();
+  }
+  _touchedCount = 0;
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 Daniel Guedel
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+#ifndef PCA9532WORKER_H
+#define PCA9532WORKER_H
+
+#include "PCA9532.h"
+
+// The worker needs std::atomic, available on ESP32 and host builds only
+#if defined(ESP32) || !defined(ARDUINO)
+#define PCA9532_HAS_WORKER
+
+#include <atomic>
+
+// Number of queued commands (power of two)
+#ifndef PCA9532_WORKER_QUEUE_SIZE
+#define PCA9532_WORKER_QUEUE_SIZE 64
+#endif
+
+static_assert((PCA9532_WORKER_QUEUE_SIZE & (PCA9532_WORKER_QUEUE_SIZE - 1)) == 0,
+              "PCA9532_WORKER_QUEUE_SIZE must be a power of two");
+
+// Number of devices flushed per batch
+#ifndef PCA9532_WORKER_MAX_DEVICES
+#define PCA9532_WORKER_MAX_DEVICES 16
+#endif
+
+/**
+ * Compact command for the worker: register = (register & ~mask) | value
+ */
+struct PCA9532Command {
+    PCA9532 *device;
+    uint8_t registerAddress;
+    uint8_t mask;
+    uint8_t value;
+};
+
+class PCA9532Worker {
+
+/******************************* PUBLIC METHODS *******************************/
+public:
+
+    /**
+     * Constructor for a bus worker. Application threads enqueue commands
+     * with the set* methods, which never touch the bus. A single worker
+     * thread or task calls run() or process(), coalesces the commands per
+     * device and sends them in bursts
+     */
+    PCA9532Worker();
+
+    /**
+     * Enqueue a register write (any thread, lock-free)
+     *
+     * @param device          PCA9532 to write to
+     * @param registerAddress Register address to write to
+     * @param data            Data to write
+     *
+     * @return false if the queue is full
+     */
+    bool setReg(PCA9532 *device, uint8_t registerAddress, uint8_t data);
+
+    /**
+     * Enqueue the LED output state for a given channel (any thread, lock-free)
+     *
+     * @param device PCA9532 to write to
+     * @param state  One of the four possible states
+     * @param regLs  Register address of LS*
+     * @param lsBit  Lower bit of LS* (see BIT_LS_LED*)
+     *
+     * @return false if the queue is full
+     */
+    bool setLsState(PCA9532 *device, uint8_t state, uint8_t regLs, uint8_t lsBit);
+
+    /**
+     * Enqueue a PWM value for channels IO_0...IO_7 or IO_8...IO_15
+     * (any thread, lock-free)
+     *
+     * @param device PCA9532 to write to
+     * @param regPwm Register address for PWM channel
+     * @param pwm    PWM value
+     *
+     * @return false if the queue is full
+     */
+    bool setPwm(PCA9532 *device, uint8_t regPwm, uint8_t pwm);
+
+    /**
+     * Move up to PCA9532_WORKER_QUEUE_SIZE commands from the queue into the
+     * register images and flush every touched device (worker thread only).
+     * The batch is capped so producers that keep the queue filled cannot
+     * hold back the flush
+     *
+     * @return number of commands processed
+     */
+    uint16_t process();
+
+    /**
+     * Process commands until stop() is called (worker thread only)
+     */
+    void run();
+
+    /**
+     * Make run() return after the current batch (any thread)
+     */
+    void stop();
+
+/****************************** PRIVATE METHODS *******************************/
+private:
+
+    /**
+     * Enqueue a command (multiple producers)
+     *
+     * @param command Command to enqueue
+     *
+     * @return false if the queue is full
+     */
+    bool enqueue(const PCA9532Command &command);
+
+    /**
+     * Dequeue a command (single consumer)
+     *
+     * @param command Dequeued command
+     *
+     * @return false if the queue is empty
+     */
+    bool dequeue(PCA9532Command &command);
+
+    /**
+     * Flush every device touched by the current batch and start a new one
+     */
+    void flushTouched();
+
+    /**
+     * Queue cell, the sequence tells producers and consumer who owns it
+     */
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        PCA9532Command command;
+    };
+
+    Cell _cells[PCA9532_WORKER_QUEUE_SIZE];
+    std::atomic<uint32_t> _enqueuePos;
+    uint32_t _dequeuePos;
+
+    /**
+     * Devices touched in the current batch
+     */
+    PCA9532 *_touched[PCA9532_WORKER_MAX_DEVICES];
+    uint8_t _touchedCount;
+
+    std::atomic<bool> _running;
+};
+
+#endif //defined(ESP32) || !defined(ARDUINO)
+#endif //PCA9532WORKER_H